@@ -38,6 +38,7 @@ namespace puml {
 static const ml_string &DT_TREE_JSONFILE = "tree.json";
 static const ml_string &DT_MLID_JSONFILE = "mlid.json";
 static const ml_double DT_COMPARISON_EQUAL_TOL = 0.00000001;
+static const ml_double DT_SPARSE_SCORE_TOL = 0.0000000001;
 
 struct dt_split {
   ml_uint split_feature_index;
@@ -45,6 +46,8 @@ struct dt_split {
   ml_feature_value split_feature_value;
   dt_comparison_op split_left_op = dt_comparison_op::noop;
   dt_comparison_op split_right_op = dt_comparison_op::noop;
+  dt_category_set split_categories;
+  bool split_missing_left = false;
   ml_double left_score = 0;
   ml_double right_score = 0;
 };
@@ -113,6 +116,15 @@ bool decision_tree::validate_for_training(const ml_data &mld) {
     return(false);
   }
 
+  if(type_ == ml_model_type::regression) {
+    for(std::size_t ii = 0; ii < mld.size(); ++ii) {
+      if(std::isnan((*mld[ii])[index_of_feature_to_predict_].continuous_value)) {
+	log_error("missing value of feature to predict in instance %zu (see ml_load_options::feature_to_predict)\n", ii);
+	return(false);
+      }
+    }
+  }
+
   return(true);  
 }
 
@@ -133,28 +145,31 @@ static ml_double calc_mean_for_continuous_feature(ml_uint feature_index, const m
 }
 
 
-static ml_uint calc_mode_value_index_for_discrete_feature(ml_uint feature_index, const ml_data &mld) {
-
-  std::map<ml_uint, ml_uint> value_map;
-
-  for(const auto &inst_ptr : mld) {
-    ml_uint discrete_value_index = (*inst_ptr)[feature_index].discrete_value_index;
-    value_map[discrete_value_index] += 1;
-  }
+//
+// a classification leaf predicts its most frequent category (ties go to the
+// lowest) and keeps the counts for predict_proba()
+//
+static void config_leaf_node_classes(const ml_vector<ml_uint> &class_counts, dt_node &leaf) {
 
   ml_uint mindex = 0, mmax = 0;
-  for(auto it = value_map.begin(); it != value_map.end(); ++it) {
-    if(it->second > mmax) {
-      mindex = it->first;
-      mmax = it->second;
+  for(std::size_t ii = 0; ii < class_counts.size(); ++ii) {
+    if(class_counts[ii] > mmax) {
+      mindex = ii;
+      mmax = class_counts[ii];
     }
   }
 
-  return(mindex);
+  leaf.feature_value.discrete_value_index = mindex;
+  leaf.leaf_class_counts = class_counts;
 }
 
 
-static bool continuous_feature_satisfies_constraint(const ml_feature_value &feature_value, const ml_feature_value &split_feature_value, dt_comparison_op op) {
+static bool continuous_feature_satisfies_constraint(const ml_feature_value &feature_value, const ml_feature_value &split_feature_value, 
+						    bool split_missing_left, dt_comparison_op op) {
+  if(std::isnan(feature_value.continuous_value)) { // missing (see ml_load_options::keep_missing)
+    return((op == dt_comparison_op::lessthanorequal) ? split_missing_left : !split_missing_left);
+  }
+
   switch(op) {
   case dt_comparison_op::lessthanorequal: return((feature_value.continuous_value < split_feature_value.continuous_value)); break; // OREQUAL, ha...
   case dt_comparison_op::greaterthan: return((feature_value.continuous_value > split_feature_value.continuous_value)); break; 
@@ -165,10 +180,28 @@ static bool continuous_feature_satisfies_constraint(const ml_feature_value &feat
 }
 
 
-static bool discrete_feature_satisfies_constraint(const ml_feature_value &feature_value, const ml_feature_value &split_feature_value, dt_comparison_op op) {
+static bool category_set_contains(const dt_category_set &categories, ml_uint discrete_value_index) {
+  ml_uint word = discrete_value_index / 64;
+  return((word < categories.size()) && (categories[word] & (((uint64_t) 1) << (discrete_value_index % 64))));
+}
+
+
+static void add_category_to_set(dt_category_set &categories, ml_uint discrete_value_index) {
+  ml_uint word = discrete_value_index / 64;
+  if(word >= categories.size()) {
+    categories.resize(word + 1, 0);
+  }
+  categories[word] |= (((uint64_t) 1) << (discrete_value_index % 64));
+}
+
+
+static bool discrete_feature_satisfies_constraint(const ml_feature_value &feature_value, const ml_feature_value &split_feature_value, 
+						  const dt_category_set &split_categories, dt_comparison_op op) {
   switch(op) {
   case dt_comparison_op::equal: return((feature_value.discrete_value_index == split_feature_value.discrete_value_index)); break;
   case dt_comparison_op::notequal: return((feature_value.discrete_value_index != split_feature_value.discrete_value_index)); break;
+  case dt_comparison_op::in: return(category_set_contains(split_categories, feature_value.discrete_value_index)); break;
+  case dt_comparison_op::notin: return(!category_set_contains(split_categories, feature_value.discrete_value_index)); break;
   default: log_error("confused by invalid split comparison operator %d (disc)... exiting.\n", op); exit(1); break;
   }
 
@@ -177,7 +210,8 @@ static bool discrete_feature_satisfies_constraint(const ml_feature_value &featur
 
 
 static bool instance_satisfies_constraint_of_split(const ml_instance &instance, ml_uint split_feature_index, ml_feature_type split_feature_type, 
-						   const ml_feature_value &split_feature_value, dt_comparison_op split_op) {
+						   const ml_feature_value &split_feature_value, const dt_category_set &split_categories, 
+						   bool split_missing_left, dt_comparison_op split_op) {
  
   if(split_feature_index >= instance.size()) {
     log_error("invalid split feature index: %d. exiting\n", split_feature_index); 
@@ -187,8 +221,8 @@ static bool instance_satisfies_constraint_of_split(const ml_instance &instance,
   const ml_feature_value &mlfv = instance[split_feature_index];
 
   switch(split_feature_type) {
-  case ml_feature_type::continuous: return(continuous_feature_satisfies_constraint(mlfv, split_feature_value, split_op)); break;
-  case ml_feature_type::discrete: return(discrete_feature_satisfies_constraint(mlfv, split_feature_value, split_op)); break;
+  case ml_feature_type::continuous: return(continuous_feature_satisfies_constraint(mlfv, split_feature_value, split_missing_left, split_op)); break;
+  case ml_feature_type::discrete: return(discrete_feature_satisfies_constraint(mlfv, split_feature_value, split_categories, split_op)); break;
   default: log_error("confused by split feature type... exiting.\n"); exit(1); break;
   }
     
@@ -202,7 +236,8 @@ static void perform_split(const ml_data &mld, const dt_split &split, ml_data &le
   rightmld.reserve(mld.size());
 
   for(const auto &inst_ptr : mld) {
-    if(instance_satisfies_constraint_of_split(*inst_ptr, split.split_feature_index, split.split_feature_type, split.split_feature_value, split.split_left_op)) {
+    if(instance_satisfies_constraint_of_split(*inst_ptr, split.split_feature_index, split.split_feature_type, split.split_feature_value, 
+					      split.split_categories, split.split_missing_left, split.split_left_op)) {
       leftmld.push_back(inst_ptr);
     }
     else {
@@ -251,6 +286,131 @@ static void add_splits_for_discrete_feature(ml_uint feature_index, const ml_data
 }
 
 
+//
+// a single subset split for a discrete feature. the categories in mld are ordered by 
+// their mean target value (regression) or by their proportion of the most frequent 
+// class in mld (classification, the best order for two classes and a heuristic for 
+// more), and the best split of that order into a left/right subset is added.
+//
+static void add_subset_split_for_discrete_feature(ml_uint feature_index, const ml_data &mld, const decision_tree &tree, ml_vector<dt_split> &splits) {
+
+  if(mld.empty()) {
+    return;
+  }
+
+  ml_uint target_index = tree.index_of_feature_to_predict();
+  bool regression = (tree.type() == ml_model_type::regression);
+  ml_uint classes = regression ? 0 : tree.mlid()[target_index]->discrete_values.size();
+
+  //
+  // target totals per category: count and sum/sum of squares or class counts
+  //
+  ml_vector<ml_uint> level_counts;
+  ml_vector<ml_double> level_sums, level_sumsqs;
+  ml_vector<ml_uint> level_class_counts;
+  ml_vector<ml_uint> class_counts(classes, 0);
+
+  for(const auto &inst_ptr : mld) {
+    ml_uint level = (*inst_ptr)[feature_index].discrete_value_index;
+    if(level >= level_counts.size()) {
+      level_counts.resize(level + 1, 0);
+      level_sums.resize(level + 1, 0);
+      level_sumsqs.resize(level + 1, 0);
+      level_class_counts.resize((level + 1) * classes, 0);
+    }
+
+    level_counts[level] += 1;
+    if(regression) {
+      ml_double target = (*inst_ptr)[target_index].continuous_value;
+      level_sums[level] += target;
+      level_sumsqs[level] += (target * target);
+    }
+    else {
+      ml_uint target = (*inst_ptr)[target_index].discrete_value_index;
+      level_class_counts[(level * classes) + target] += 1;
+      class_counts[target] += 1;
+    }
+  }
+
+  ml_uint majority_class = 0;
+  for(ml_uint ii = 0; ii < classes; ++ii) {
+    majority_class = (class_counts[ii] > class_counts[majority_class]) ? ii : majority_class;
+  }
+
+  ml_vector<std::pair<ml_double, ml_uint>> levels;
+  for(ml_uint level = 0; level < level_counts.size(); ++level) {
+    if(level_counts[level] > 0) {
+      ml_double key = regression ? level_sums[level] : level_class_counts[(level * classes) + majority_class];
+      levels.push_back(std::make_pair(key / level_counts[level], level));
+    }
+  }
+
+  //
+  // only 1 level so no split possible
+  //
+  if(levels.size() < 2) {
+    return;
+  }
+
+  std::sort(levels.begin(), levels.end());
+
+  //
+  // score each split of the ordered categories from the running totals of the left side
+  //
+  ml_uint lcount = 0;
+  ml_double lsum = 0, lsumsq = 0, total_sum = 0, total_sumsq = 0;
+  ml_vector<ml_uint> left_class_counts(classes, 0);
+  for(const auto &level : levels) {
+    total_sum += regression ? level_sums[level.second] : 0;
+    total_sumsq += regression ? level_sumsqs[level.second] : 0;
+  }
+
+  ml_double best_score = std::numeric_limits<ml_double>::max();
+  std::size_t best_left_levels = 0;
+
+  for(std::size_t ii = 0; ii < (levels.size() - 1); ++ii) {
+    ml_uint level = levels[ii].second;
+    lcount += level_counts[level];
+    ml_uint rcount = mld.size() - lcount;
+    ml_double score = 0;
+
+    if(regression) {
+      lsum += level_sums[level];
+      lsumsq += level_sumsqs[level];
+      ml_double rsum = total_sum - lsum, rsumsq = total_sumsq - lsumsq;
+      score = (lsumsq - ((lsum * lsum) / lcount)) + (rsumsq - ((rsum * rsum) / rcount));
+    }
+    else {
+      ml_double lscore = 0, rscore = 0;
+      for(ml_uint jj = 0; jj < classes; ++jj) {
+	left_class_counts[jj] += level_class_counts[(level * classes) + jj];
+	ml_double lproportion = ((ml_double) left_class_counts[jj] / lcount);
+	ml_double rproportion = ((ml_double) (class_counts[jj] - left_class_counts[jj]) / rcount);
+	lscore += (lproportion * (1.0 - lproportion));
+	rscore += (rproportion * (1.0 - rproportion));
+      }
+      score = (((ml_double) lcount / mld.size()) * lscore) + (((ml_double) rcount / mld.size()) * rscore);
+    }
+
+    if(score < best_score) {
+      best_score = score;
+      best_left_levels = ii + 1;
+    }
+  }
+
+  dt_split dsplit{};
+  dsplit.split_feature_index = feature_index;
+  dsplit.split_feature_type = ml_feature_type::discrete;
+  dsplit.split_feature_value.discrete_value_index = levels[0].second;
+  dsplit.split_left_op = dt_comparison_op::in;
+  dsplit.split_right_op = dt_comparison_op::notin;
+  for(std::size_t ii = 0; ii < best_left_levels; ++ii) {
+    add_category_to_set(dsplit.split_categories, levels[ii].second);
+  }
+  splits.push_back(dsplit);
+}
+
+
 static void add_splits_for_continuous_feature(ml_uint feature_index, const ml_data &mld, ml_vector<dt_split> &splits) {
 
   // 
@@ -261,17 +421,26 @@ static void add_splits_for_continuous_feature(ml_uint feature_index, const ml_da
     return;
   }
 
-  ml_uint count = 0;
+  ml_uint count = 0, missing = 0;
   ml_double mean = 0, M2 = 0;
 
   for(const auto &inst_ptr : mld) {
     ml_double fval = (*inst_ptr)[feature_index].continuous_value;
+    if(std::isnan(fval)) {
+      ++missing;
+      continue;
+    }
+
     ++count;
     ml_double delta = fval - mean;
     mean = mean + (delta / count);
     M2 = M2 + (delta * (fval - mean));
   }
 
+  if(count == 0) {
+    return;
+  }
+
   ml_double std = (count < 2) ? 0.0 : std::sqrt( M2 / (count - 1));
 
   dt_split csplit{};
@@ -279,21 +448,141 @@ static void add_splits_for_continuous_feature(ml_uint feature_index, const ml_da
   csplit.split_feature_type = ml_feature_type::continuous;
   csplit.split_right_op = dt_comparison_op::greaterthan;
   csplit.split_left_op = dt_comparison_op::lessthanorequal;
-  
-  csplit.split_feature_value.continuous_value = mean;
-  splits.push_back(csplit);    
 
+  ml_vector<ml_double> thresholds = { mean };
   if(std > 0.0) {
-    csplit.split_feature_value.continuous_value = mean + (std / 2.0);
-    splits.push_back(csplit);  
+    thresholds.push_back(mean + (std / 2.0));
+    thresholds.push_back(mean - (std / 2.0));
+  }
 
-    csplit.split_feature_value.continuous_value = mean - (std / 2.0);
-    splits.push_back(csplit);      
+  //
+  // with missing values each threshold is tried with them on either side
+  //
+  for(const auto &threshold : thresholds) {
+    csplit.split_feature_value.continuous_value = threshold;
+    csplit.split_missing_left = false;
+    splits.push_back(csplit);
+
+    if(missing > 0) {
+      csplit.split_missing_left = true;
+      splits.push_back(csplit);
+    }
   }
   
 }
 
 
+//
+// a uniformly random number in (0,1)
+//
+static ml_double random_unit_interval(ml_rng &rng) {
+  return((rng.random_number() + 0.5) / 4294967296.0);
+}
+
+
+//
+// extra-trees: a single split of a discrete feature on a random category of mld, 
+// or a random subset of its categories with categorical subset splits
+//
+static void add_random_split_for_discrete_feature(ml_uint feature_index, const ml_data &mld, const decision_tree &tree, 
+						  ml_rng &rng, ml_vector<dt_split> &splits) {
+
+  ml_vector<ml_uint> levels;
+  ml_set<ml_uint> seen;
+  for(const auto &inst_ptr : mld) {
+    ml_uint level = (*inst_ptr)[feature_index].discrete_value_index;
+    if(seen.insert(level).second) {
+      levels.push_back(level);
+    }
+  }
+
+  //
+  // only 1 level so no split possible
+  //
+  if(levels.size() < 2) {
+    return;
+  }
+
+  std::sort(levels.begin(), levels.end());
+
+  dt_split dsplit{};
+  dsplit.split_feature_index = feature_index;
+  dsplit.split_feature_type = ml_feature_type::discrete;
+
+  if(!tree.categorical_subset_splits()) {
+    dsplit.split_feature_value.discrete_value_index = levels[rng.random_number() % levels.size()];
+    dsplit.split_right_op = dt_comparison_op::equal;
+    dsplit.split_left_op = dt_comparison_op::notequal;
+    splits.push_back(dsplit);
+    return;
+  }
+
+  //
+  // each category goes left with probability 1/2. the first category 
+  // stays on the left and the last on the right if a side is empty
+  //
+  ml_uint left_levels = 0;
+  for(const auto &level : levels) {
+    if(rng.random_number() & 1) {
+      add_category_to_set(dsplit.split_categories, level);
+      ++left_levels;
+    }
+  }
+
+  if((left_levels == 0) || (left_levels == levels.size())) {
+    dsplit.split_categories.clear();
+    add_category_to_set(dsplit.split_categories, levels[0]);
+    for(std::size_t ii = 1; (left_levels > 0) && (ii < (levels.size() - 1)); ++ii) {
+      add_category_to_set(dsplit.split_categories, levels[ii]);
+    }
+  }
+
+  dsplit.split_feature_value.discrete_value_index = levels[0];
+  dsplit.split_left_op = dt_comparison_op::in;
+  dsplit.split_right_op = dt_comparison_op::notin;
+  splits.push_back(dsplit);
+}
+
+
+//
+// extra-trees: a single split of a continuous feature at a uniformly random 
+// threshold between its min and max in mld (none if the feature is constant)
+//
+static void add_random_split_for_continuous_feature(ml_uint feature_index, const ml_data &mld, ml_rng &rng, ml_vector<dt_split> &splits) {
+
+  ml_uint missing = 0;
+  ml_double min_value = std::numeric_limits<ml_double>::max(), max_value = std::numeric_limits<ml_double>::lowest();
+
+  for(const auto &inst_ptr : mld) {
+    ml_double fval = (*inst_ptr)[feature_index].continuous_value;
+    if(std::isnan(fval)) {
+      ++missing;
+      continue;
+    }
+
+    min_value = std::min(min_value, fval);
+    max_value = std::max(max_value, fval);
+  }
+
+  if(!(min_value < max_value)) {
+    return;
+  }
+
+  dt_split csplit{};
+  csplit.split_feature_index = feature_index;
+  csplit.split_feature_type = ml_feature_type::continuous;
+  csplit.split_right_op = dt_comparison_op::greaterthan;
+  csplit.split_left_op = dt_comparison_op::lessthanorequal;
+  csplit.split_feature_value.continuous_value = min_value + (random_unit_interval(rng) * (max_value - min_value));
+  splits.push_back(csplit);
+
+  if(missing > 0) {
+    csplit.split_missing_left = true;
+    splits.push_back(csplit);
+  }
+}
+
+
 //
 // score regions for regression using residual sum of squares (approx)
 // returns a tuple with (left region score, right region score, combined score)
@@ -313,7 +602,7 @@ static std::tuple<ml_double, ml_double, ml_double> score_regions_with_split_for_
     if((split.split_left_op == dt_comparison_op::noop) || 
        instance_satisfies_constraint_of_split(*inst_ptr, split.split_feature_index, 
 					      split.split_feature_type, split.split_feature_value,
-					      split.split_left_op)) {
+					      split.split_categories, split.split_missing_left, split.split_left_op)) {
       ++n_left;
       ml_double delta = feature_val - mean_left;
       mean_left = mean_left + (delta / n_left);
@@ -354,7 +643,7 @@ static std::tuple<ml_double, ml_double, ml_double> score_regions_with_split_for_
     if((split.split_left_op == dt_comparison_op::noop) || 
        instance_satisfies_constraint_of_split(*inst_ptr, split.split_feature_index, 
 					      split.split_feature_type, split.split_feature_value,
-					      split.split_left_op)) {
+					      split.split_categories, split.split_missing_left, split.split_left_op)) {
       left_value_map[discrete_value_index] += 1;
       ++lcount;
     }
@@ -464,8 +753,25 @@ bool decision_tree::find_best_split(const ml_data &mld, dt_split &best_split, ml
     }
 
     switch(mlid_[findex]->type) {
-    case ml_feature_type::discrete: add_splits_for_discrete_feature(findex, mld, splits); break;
-    case ml_feature_type::continuous: add_splits_for_continuous_feature(findex, mld, splits); break;
+    case ml_feature_type::discrete: 
+      if(extra_trees_) {
+	add_random_split_for_discrete_feature(findex, mld, *this, rng_, splits);
+      }
+      else if(categorical_subset_splits_) {
+	add_subset_split_for_discrete_feature(findex, mld, *this, splits); 
+      }
+      else {
+	add_splits_for_discrete_feature(findex, mld, splits); 
+      }
+      break;
+    case ml_feature_type::continuous: 
+      if(extra_trees_) {
+	add_random_split_for_continuous_feature(findex, mld, rng_, splits);
+      }
+      else {
+	add_splits_for_continuous_feature(findex, mld, splits); 
+      }
+      break;
     default: log_error("invalid feature type...\n"); break;
     }
   }
@@ -517,7 +823,14 @@ void decision_tree::config_leaf_node(const ml_data &mld, dt_node_ptr &leaf) {
     leaf->feature_value.continuous_value = calc_mean_for_continuous_feature(leaf->feature_index, mld);
   }
   else {
-    leaf->feature_value.discrete_value_index = calc_mode_value_index_for_discrete_feature(leaf->feature_index, mld);
+    ml_vector<ml_uint> class_counts(mlid_[index_of_feature_to_predict_]->discrete_values.size(), 0);
+    for(const auto &inst_ptr : mld) {
+      ml_uint discrete_value_index = (*inst_ptr)[leaf->feature_index].discrete_value_index;
+      if(discrete_value_index < class_counts.size()) {
+	class_counts[discrete_value_index] += 1;
+      }
+    }
+    config_leaf_node_classes(class_counts, *leaf);
   }
 
   if(keep_instances_at_leaf_nodes_) {
@@ -533,6 +846,8 @@ static void config_split_node(const dt_split &split, dt_node_ptr &split_node) {
   split_node->feature_value = split.split_feature_value;
   split_node->split_left_op = split.split_left_op;
   split_node->split_right_op = split.split_right_op;
+  split_node->split_categories = split.split_categories;
+  split_node->split_missing_left = split.split_missing_left;
 }
 
 
@@ -621,120 +936,1126 @@ bool decision_tree::train(const ml_data &mld) {
 }
 
 
-static ml_string name_for_split_operator(dt_comparison_op op) {
-  
-  ml_string op_name;
+//
+// state for building a tree from sparse data: the target value of each row
+// and scratch space for gathering the non-zero values of features in a node
+//
+struct dt_sparse_context {
+  const ml_sparse_data &mlsd;
+  ml_vector<ml_feature_value> targets;
+  ml_vector<ml_vector<std::pair<ml_uint, ml_float>>> feature_values; // (row, value)
+  ml_vector<ml_uint> node_features;
+  ml_vector<char> considered_features;
+};
 
-  switch(op) {
-  case dt_comparison_op::noop : op_name = "no-op"; break;
-  case dt_comparison_op::lessthanorequal: op_name = "<="; break;
-  case dt_comparison_op::greaterthan: op_name = ">"; break;
-  case dt_comparison_op::equal: op_name = "="; break;
-  case dt_comparison_op::notequal: op_name = "!="; break;
-  default: log_error("invalid split operator"); break;
-  }
 
-  return(op_name);
-}
+//
+// target totals of a region of sparse rows: count, sum and sum of 
+// squares for regression, class counts for classification
+//
+struct dt_sparse_totals {
+  ml_uint count = 0;
+  ml_double sum = 0;
+  ml_double sumsq = 0;
+  ml_vector<ml_uint> class_counts;
+};
 
 
-static void decision_tree_node_desc(const ml_instance_definition &mlid, const dt_node &node, ml_uint depth, ml_string &desc) {
+static void reset_sparse_totals(const decision_tree &tree, dt_sparse_totals &totals) {
+  totals.count = 0;
+  totals.sum = totals.sumsq = 0;
+  if(tree.type() == ml_model_type::classification) {
+    totals.class_counts.assign(tree.mlid()[tree.index_of_feature_to_predict()]->discrete_values.size(), 0);
+  }
+}
 
-  ml_string feature_value_as_string;
-  if(node.feature_type == ml_feature_type::discrete) {
-    feature_value_as_string = mlid[node.feature_index]->discrete_values[node.feature_value.discrete_value_index];
+
+static void add_target_to_sparse_totals(const ml_feature_value &target, dt_sparse_totals &totals) {
+  totals.count += 1;
+  if(totals.class_counts.empty()) {
+    totals.sum += target.continuous_value;
+    totals.sumsq += ((ml_double) target.continuous_value * target.continuous_value);
   }
   else {
-    feature_value_as_string = std::to_string(node.feature_value.continuous_value);
+    totals.class_counts[target.discrete_value_index] += 1;
   }
+}
 
-  if(node.node_type == dt_node_type::split) { 
-    // Left Side
-    desc += "\n";
-    for(ml_uint ii=0; ii < depth; ++ii) {
-      desc += "|  ";
-    }
-
-    desc += mlid[node.feature_index]->name + " ";
-    desc += name_for_split_operator(node.split_left_op) + " ";
-    desc += feature_value_as_string;
-    decision_tree_node_desc(mlid, *node.split_left_node, depth+1, desc);
-  
-    // Right Side
-    desc += "\n";
-    for(ml_uint ii=0; ii < depth; ++ii) {
-      desc += "|  ";
-    }
 
-    desc += mlid[node.feature_index]->name + " ";
-    desc += name_for_split_operator(node.split_right_op) + " ";
-    desc += feature_value_as_string;
-    decision_tree_node_desc(mlid, *node.split_right_node, depth+1, desc);
-  }
-  else {
-    // dt_node_type::leaf
-    desc += ": " + feature_value_as_string;
+//
+// totals += (sign * other)
+//
+static void combine_sparse_totals(dt_sparse_totals &totals, const dt_sparse_totals &other, int sign) {
+  totals.count += (sign * (int) other.count);
+  totals.sum += (sign * other.sum);
+  totals.sumsq += (sign * other.sumsq);
+  for(std::size_t ii = 0; ii < totals.class_counts.size(); ++ii) {
+    totals.class_counts[ii] += (sign * (int) other.class_counts[ii]);
   }
-  
 }
-  
 
-ml_string decision_tree::summary() const {
 
-  if(mlid_.empty() || !root_) {
-    return("(empty decision tree)\n");
+//
+// residual sum of squares for regression, Gini index for classification 
+// (the same scores as score_regions_with_split)
+//
+static ml_double score_sparse_totals(const dt_sparse_totals &totals) {
+
+  if(totals.count == 0) {
+    return(0.0);
   }
 
-  ml_string desc;
-  desc += "\n\n*** Decision Tree Summary ***\n\n";
-  desc += "Feature To Predict: " + mlid_[index_of_feature_to_predict_]->name + "\n";
-  ml_string type_str = (type_ == ml_model_type::regression) ? "regression" : "classification";
-  desc += "Type: " + type_str;
-  desc += ", Max Depth: " + std::to_string(max_tree_depth_);
-  desc += ", Min Leaf Instances: " + std::to_string(min_leaf_instances_);
-  if(features_to_consider_per_node_ > 0) {
-    desc += ", Features p/n: " + std::to_string(features_to_consider_per_node_);
-    desc += ", Seed: " + std::to_string(seed_);
+  if(totals.class_counts.empty()) {
+    //
+    // rss within rounding error of zero is zero (e.g. equal values), as with welford
+    //
+    ml_double rss = totals.sumsq - ((totals.sum * totals.sum) / totals.count);
+    return((rss > (totals.sumsq * DT_SPARSE_SCORE_TOL)) ? rss : 0.0);
   }
-  
-  desc += ", Leaves: " + std::to_string(leaves_);
-  desc += ", Size: " + std::to_string(nodes_) + "\n";
-  decision_tree_node_desc(mlid_, *root_, 0, desc);
-  desc += "\n\n";
 
-  return(desc);
+  ml_double score = 0.0;
+  for(const auto &class_count : totals.class_counts) {
+    ml_double class_proportion = ((ml_double) class_count / totals.count);
+    score += (class_proportion * (1.0 - class_proportion));
+  }
+
+  return(score);
 }
 
 
-static const ml_feature_value evaluate_decision_tree_node_for_instance(const dt_node &node, const ml_instance &instance) {
+static bool sparse_row_satisfies_constraint_of_split(const ml_sparse_data &mlsd, std::size_t row, ml_uint split_feature_index, ml_feature_type split_feature_type, 
+						     const ml_feature_value &split_feature_value, const dt_category_set &split_categories, 
+						     bool split_missing_left, dt_comparison_op split_op) {
 
-  if(node.node_type == dt_node_type::leaf) {
-    return(node.feature_value);
-  }
+  const ml_feature_value mlfv = mlsd.value(row, split_feature_index);
 
-  if(instance_satisfies_constraint_of_split(instance, node.feature_index, node.feature_type, node.feature_value, node.split_left_op)) {
-    return(evaluate_decision_tree_node_for_instance(*node.split_left_node, instance));
+  switch(split_feature_type) {
+  case ml_feature_type::continuous: return(continuous_feature_satisfies_constraint(mlfv, split_feature_value, split_missing_left, split_op)); break;
+  case ml_feature_type::discrete: return(discrete_feature_satisfies_constraint(mlfv, split_feature_value, split_categories, split_op)); break;
+  default: log_error("confused by split feature type... exiting.\n"); exit(1); break;
   }
+    
+  return(false);
+}
+
 
-  return(evaluate_decision_tree_node_for_instance(*node.split_right_node, instance));
+static void perform_sparse_split(const ml_sparse_data &mlsd, const ml_vector<ml_uint> &rows, const dt_split &split, 
+				 ml_vector<ml_uint> &left_rows, ml_vector<ml_uint> &right_rows) {
+ 
+  left_rows.reserve(rows.size());
+  right_rows.reserve(rows.size());
+
+  for(const auto &row : rows) {
+    if(sparse_row_satisfies_constraint_of_split(mlsd, row, split.split_feature_index, split.split_feature_type, split.split_feature_value, 
+						split.split_categories, split.split_missing_left, split.split_left_op)) {
+      left_rows.push_back(row);
+    }
+    else {
+      right_rows.push_back(row);
+    }
+  }
 }
 
 
-ml_feature_value decision_tree::evaluate(const ml_instance &instance) const {
+bool decision_tree::validate_for_training(const ml_sparse_data &mlsd, const ml_vector<ml_uint> &rows) {
 
-  ml_feature_value empty = {};
-  if(!root_ || mlid_.empty()) {
-    log_warn("evaluate called on an empty tree...\n");
-    return(empty);
+  if(mlid_.empty()) {
+    log_error("empty instance definition...\n");
+    return(false);
   }
 
-  if(instance.size() < mlid_.size()) {
-    log_error("feature count mismatch b/t instance definition and instance to evaluate\n");
-    return(empty);
+  if(mlsd.empty() || rows.empty()) {
+    log_error("empty instance data set...\n");
+    return(false);
   }
 
-  return(evaluate_decision_tree_node_for_instance(*root_, instance));
-}
+  if(index_of_feature_to_predict_ >= mlid_.size()) {
+    log_error("invalid index of feature to predict...\n");
+    return(false);
+  }
+
+  if(min_leaf_instances_ == 0) {
+    log_error("minimum leaf instances must be greater than 0\n");
+    return(false);
+  }
+
+  for(std::size_t findex = 0; findex < mlid_.size(); ++findex) {
+    if((findex != index_of_feature_to_predict_) && (mlid_[findex]->type != ml_feature_type::continuous)) {
+      log_error("sparse data supports continuous features only (%s is discrete)\n", mlid_[findex]->name.c_str());
+      return(false);
+    }
+  }
+
+  ml_uint categories = mlid_[index_of_feature_to_predict_]->discrete_values.size();
+  for(const auto &row : rows) {
+    if(row >= mlsd.size()) {
+      log_error("invalid row index: %u\n", row);
+      return(false);
+    }
+
+    if((type_ == ml_model_type::classification) && (mlsd.value(row, index_of_feature_to_predict_).discrete_value_index >= categories)) {
+      log_error("invalid category of feature to predict in row %u\n", row);
+      return(false);
+    }
+
+    if((type_ == ml_model_type::regression) && std::isnan(mlsd.value(row, index_of_feature_to_predict_).continuous_value)) {
+      log_error("missing value of feature to predict in row %u\n", row);
+      return(false);
+    }
+  }
+
+  return(true);  
+}
+
+
+bool decision_tree::find_best_sparse_split(dt_sparse_context &context, const ml_vector<ml_uint> &rows, dt_split &best_split, ml_double score) {
+
+  ml_map<ml_uint, bool> random_features_to_consider;
+  if(features_to_consider_per_node_ > 0) {
+    pick_random_features_to_consider(*this, rng_, random_features_to_consider);
+  }
+
+  for(const auto &feature : random_features_to_consider) {
+    context.considered_features[feature.first] = 1;
+  }
+
+  //
+  // gather the non-zero values of each feature in the node along with 
+  // the target totals of the node
+  //
+  const ml_sparse_data &mlsd = context.mlsd;
+  dt_sparse_totals totals;
+  reset_sparse_totals(*this, totals);
+
+  for(const auto &row : rows) {
+    add_target_to_sparse_totals(context.targets[row], totals);
+
+    for(std::size_t ii = mlsd.row_offsets[row]; ii < mlsd.row_offsets[row + 1]; ++ii) {
+      ml_uint findex = mlsd.feature_indices[ii];
+      if((findex >= mlid_.size()) || (findex == index_of_feature_to_predict_) ||
+	 (!random_features_to_consider.empty() && !context.considered_features[findex])) {
+	continue;
+      }
+
+      auto &values = context.feature_values[findex];
+      if(values.empty()) {
+	context.node_features.push_back(findex);
+      }
+      values.push_back(std::make_pair(row, mlsd.values[ii].continuous_value));
+    }
+  }
+
+  for(const auto &feature : random_features_to_consider) {
+    context.considered_features[feature.first] = 0;
+  }
+
+  std::sort(context.node_features.begin(), context.node_features.end());
+
+  //
+  // a considered feature without non-zero values in the node is constant. the dense
+  // search scores its (all right) split too and ties go to the lowest feature index,
+  // so the first of these features is a candidate as well
+  //
+  ml_uint zero_findex = mlid_.size();
+  if(!random_features_to_consider.empty()) {
+    for(const auto &feature : random_features_to_consider) {
+      if(context.feature_values[feature.first].empty() && (feature.first < zero_findex)) {
+	zero_findex = feature.first;
+      }
+    }
+  }
+  else {
+    zero_findex = (index_of_feature_to_predict_ == 0) ? 1 : 0;
+    for(const auto &findex : context.node_features) {
+      if(findex != zero_findex) {
+	break;
+      }
+      zero_findex += ((zero_findex + 1) == index_of_feature_to_predict_) ? 2 : 1;
+    }
+  }
+
+  if(zero_findex < mlid_.size()) {
+    context.node_features.insert(std::lower_bound(context.node_features.begin(), context.node_features.end(), zero_findex), zero_findex);
+  }
+
+  ml_double best_score = std::numeric_limits<ml_double>::max();
+  ml_double best_left_score = 0, best_right_score = 0;
+  bool found_split = false;
+
+  dt_sparse_totals nonzeros, missing, zeros, left, right;
+
+  for(const auto &findex : context.node_features) {
+
+    auto &values = context.feature_values[findex];
+
+    //
+    // candidate thresholds from the distribution of the feature in the node 
+    // (as add_splits_for_continuous_feature), including zeros. missing (NaN) 
+    // values are left out and tried on either side of each threshold.
+    //
+    reset_sparse_totals(*this, nonzeros);
+    reset_sparse_totals(*this, missing);
+    ml_double sum = 0, sumsq = 0;
+    ml_float min_value = std::numeric_limits<ml_float>::max(), max_value = std::numeric_limits<ml_float>::lowest();
+    for(const auto &value : values) {
+      add_target_to_sparse_totals(context.targets[value.first], nonzeros);
+      if(std::isnan(value.second)) {
+	add_target_to_sparse_totals(context.targets[value.first], missing);
+	continue;
+      }
+
+      sum += value.second;
+      sumsq += ((ml_double) value.second * value.second);
+      min_value = std::min(min_value, value.second);
+      max_value = std::max(max_value, value.second);
+    }
+
+    ml_uint count = rows.size() - missing.count;
+    if(count == 0) {
+      values.clear();
+      continue;
+    }
+
+    ml_double mean = sum / count;
+    ml_double variance = (count < 2) ? 0.0 : ((sumsq - (sum * mean)) / (count - 1));
+    if((nonzeros.count == missing.count) || (((nonzeros.count - missing.count) == count) && (min_value == max_value))) { // constant, exactly
+      mean = (nonzeros.count == missing.count) ? 0.0 : min_value;
+      variance = 0.0;
+    }
+    ml_double std = (variance > 0.0) ? std::sqrt(variance) : 0.0;
+
+    ml_vector<ml_double> thresholds = { mean };
+    if(std > 0.0) {
+      thresholds.push_back(mean + (std / 2.0));
+      thresholds.push_back(mean - (std / 2.0));
+    }
+
+    //
+    // extra-trees: one random threshold between the min and max (zeros included) 
+    // of the feature in the node, as add_random_split_for_continuous_feature
+    //
+    if(extra_trees_) {
+      if((nonzeros.count - missing.count) < count) {
+	min_value = std::min(min_value, (ml_float) 0.0);
+	max_value = std::max(max_value, (ml_float) 0.0);
+      }
+
+      if(!(min_value < max_value)) {
+	values.clear();
+	continue;
+      }
+
+      thresholds = { min_value + (random_unit_interval(rng_) * ((ml_double) max_value - min_value)) };
+    }
+
+    //
+    // the rows without a value for the feature (zeros) are the 
+    // node totals less the rows with non-zero values
+    //
+    zeros = totals;
+    combine_sparse_totals(zeros, nonzeros, -1);
+
+    for(const auto &threshold : thresholds) {
+
+      dt_split csplit{};
+      csplit.split_feature_index = findex;
+      csplit.split_feature_type = ml_feature_type::continuous;
+      csplit.split_feature_value.continuous_value = threshold;
+      csplit.split_right_op = dt_comparison_op::greaterthan;
+      csplit.split_left_op = dt_comparison_op::lessthanorequal;
+
+      reset_sparse_totals(*this, left);
+      for(const auto &value : values) {
+	if(value.second < csplit.split_feature_value.continuous_value) {
+	  add_target_to_sparse_totals(context.targets[value.first], left);
+	}
+      }
+
+      if(0.0 < csplit.split_feature_value.continuous_value) {
+	combine_sparse_totals(left, zeros, 1);
+      }
+
+      for(int missing_left = 0; missing_left < ((missing.count > 0) ? 2 : 1); ++missing_left) {
+
+	if(missing_left) {
+	  combine_sparse_totals(left, missing, 1);
+	  csplit.split_missing_left = true;
+	}
+
+	right = totals;
+	combine_sparse_totals(right, left, -1);
+
+	ml_double lscore = score_sparse_totals(left);
+	ml_double rscore = score_sparse_totals(right);
+	ml_double combined_score = (type_ == ml_model_type::regression) ? (lscore + rscore) :
+	  ((((ml_double) left.count / totals.count) * lscore) + (((ml_double) right.count / totals.count) * rscore));
+
+	//
+	// scores within rounding error are ties (the order of the sums differs per feature)
+	//
+	if(combined_score < (best_score - (fabs(best_score) * DT_SPARSE_SCORE_TOL))) {
+	  best_score = combined_score;
+	  best_left_score = lscore;
+	  best_right_score = rscore;
+	  best_split = csplit;
+	  found_split = true;
+	}
+      }
+    }
+
+    values.clear();
+  }
+
+  context.node_features.clear();
+
+  if(found_split) {
+    best_split.left_score = best_left_score;
+    best_split.right_score = best_right_score;
+
+    feature_importance_[best_split.split_feature_index].sum_score_delta += (score - best_score);
+    feature_importance_[best_split.split_feature_index].count += 1;
+
+    return(true);
+  }
+
+  best_split.split_feature_index = 0;
+  best_split.split_left_op = best_split.split_right_op = dt_comparison_op::noop;
+  return(false);
+}
+
+
+void decision_tree::config_sparse_leaf_node(const dt_sparse_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &leaf) {
+  leaves_ += 1;
+  leaf->node_type = dt_node_type::leaf;
+  leaf->feature_index = index_of_feature_to_predict_;
+  leaf->feature_type = mlid_[index_of_feature_to_predict_]->type;
+
+  dt_sparse_totals totals;
+  reset_sparse_totals(*this, totals);
+  for(const auto &row : rows) {
+    add_target_to_sparse_totals(context.targets[row], totals);
+  }
+
+  if(type_ == ml_model_type::regression) {
+    leaf->feature_value.continuous_value = (totals.count > 0) ? (totals.sum / totals.count) : 0.0;
+  }
+  else {
+    config_leaf_node_classes(totals.class_counts, *leaf);
+  }
+
+  if(keep_instances_at_leaf_nodes_) {
+    for(const auto &row : rows) {
+      leaf->leaf_instances.push_back(std::make_shared<ml_instance>(context.mlsd.instance(row, mlid_.size())));
+    }
+  }
+}
+
+
+void decision_tree::build_sparse_tree_node(dt_sparse_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &node, ml_uint depth, ml_double score) {
+  
+  node = std::make_shared<dt_node>();
+  if(!node) {
+    log_error("out of memory. aborting...\n");
+    abort();
+  }
+
+  nodes_ += 1;
+
+  if(depth == max_tree_depth_) {
+    config_sparse_leaf_node(context, rows, node);
+    return;
+  }
+  
+  dt_split best_split = {};
+  ml_vector<ml_uint> left_rows, right_rows;
+
+  if(find_best_sparse_split(context, rows, best_split, score)) {
+    perform_sparse_split(context.mlsd, rows, best_split, left_rows, right_rows);
+  }
+
+  if((left_rows.size() < min_leaf_instances_) || 
+     (right_rows.size() < min_leaf_instances_)) {
+    config_sparse_leaf_node(context, rows, node);
+    return;
+  }
+
+  config_split_node(best_split, node);
+
+  build_sparse_tree_node(context, left_rows, node->split_left_node, depth+1, best_split.left_score);
+  build_sparse_tree_node(context, right_rows, node->split_right_node, depth+1, best_split.right_score);
+
+  if(prune_twin_leaf_nodes(node)) {
+    config_sparse_leaf_node(context, rows, node);
+  }
+ 
+}
+
+
+bool decision_tree::train(const ml_sparse_data &mlsd) {
+
+  ml_vector<ml_uint> rows(mlsd.size());
+  for(std::size_t ii = 0; ii < rows.size(); ++ii) {
+    rows[ii] = ii;
+  }
+
+  return(train(mlsd, rows));
+}
+
+
+bool decision_tree::train(const ml_sparse_data &mlsd, const ml_vector<ml_uint> &rows) {
+
+  if(!validate_for_training(mlsd, rows)) {
+    return(false);
+  }
+
+  root_ = nullptr;
+  nodes_ = leaves_ = 0;
+  feature_importance_.clear();
+  feature_importance_.resize(mlid_.size());
+
+  dt_sparse_context context{mlsd, {}, {}, {}, {}};
+  context.targets.resize(mlsd.size());
+  context.feature_values.resize(mlid_.size());
+  context.considered_features.resize(mlid_.size(), 0);
+
+  dt_sparse_totals totals;
+  reset_sparse_totals(*this, totals);
+  for(const auto &row : rows) {
+    context.targets[row] = mlsd.value(row, index_of_feature_to_predict_);
+    add_target_to_sparse_totals(context.targets[row], totals);
+  }
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  build_sparse_tree_node(context, rows, root_, 0, score_sparse_totals(totals)); 
+  auto t2 = std::chrono::high_resolution_clock::now();
+   
+  ml_uint ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2-t1).count();
+  log("built tree %s in %.3f seconds (%u leaves, %u nodes)\n", name_.c_str(), (ms / 1000.0), leaves_, nodes_); 
+
+  return(true);
+}
+
+
+//
+// state for building a tree from prepared data: the target value of each row, 
+// the target totals per code of a feature in a node (and the codes with rows
+// in the node) and the last code on the left of the best continuous split
+//
+struct dt_prepared_context {
+  const ml_prepared_data &mlpd;
+  ml_vector<ml_feature_value> targets;
+  ml_vector<dt_sparse_totals> code_totals;
+  ml_vector<ml_uint> node_codes;
+  ml_uint split_code;
+};
+
+
+static bool prepared_row_satisfies_constraint_of_split(const dt_prepared_context &context, ml_uint row, const dt_split &split) {
+
+  ml_uint code = context.mlpd.columns[split.split_feature_index][row];
+  if(split.split_feature_type == ml_feature_type::continuous) {
+    return((code == context.mlpd.missing_code(split.split_feature_index)) ? split.split_missing_left : (code <= context.split_code));
+  }
+
+  ml_feature_value mlfv;
+  mlfv.discrete_value_index = code;
+  return(discrete_feature_satisfies_constraint(mlfv, split.split_feature_value, split.split_categories, split.split_left_op));
+}
+
+
+static void perform_prepared_split(const dt_prepared_context &context, const ml_vector<ml_uint> &rows, const dt_split &split, 
+				   ml_vector<ml_uint> &left_rows, ml_vector<ml_uint> &right_rows) {
+ 
+  left_rows.reserve(rows.size());
+  right_rows.reserve(rows.size());
+
+  for(const auto &row : rows) {
+    if(prepared_row_satisfies_constraint_of_split(context, row, split)) {
+      left_rows.push_back(row);
+    }
+    else {
+      right_rows.push_back(row);
+    }
+  }
+}
+
+
+bool decision_tree::validate_for_training(const ml_prepared_data &mlpd, const ml_vector<ml_uint> &rows) {
+
+  if(mlid_.empty()) {
+    log_error("empty instance definition...\n");
+    return(false);
+  }
+
+  if(mlpd.empty() || rows.empty()) {
+    log_error("empty instance data set...\n");
+    return(false);
+  }
+
+  if((mlpd.mlid.size() != mlid_.size()) || (mlpd.columns.size() != mlid_.size())) {
+    log_error("feature count mismatch b/t instance definition and prepared data\n");
+    return(false);
+  }
+
+  if(index_of_feature_to_predict_ >= mlid_.size()) {
+    log_error("invalid index of feature to predict...\n");
+    return(false);
+  }
+
+  if(min_leaf_instances_ == 0) {
+    log_error("minimum leaf instances must be greater than 0\n");
+    return(false);
+  }
+
+  ml_uint categories = mlid_[index_of_feature_to_predict_]->discrete_values.size();
+  for(const auto &row : rows) {
+    if(row >= mlpd.size()) {
+      log_error("invalid row index: %u\n", row);
+      return(false);
+    }
+
+    if((type_ == ml_model_type::classification) && ((*mlpd.mld[row])[index_of_feature_to_predict_].discrete_value_index >= categories)) {
+      log_error("invalid category of feature to predict in row %u\n", row);
+      return(false);
+    }
+
+    if((type_ == ml_model_type::regression) && std::isnan((*mlpd.mld[row])[index_of_feature_to_predict_].continuous_value)) {
+      log_error("missing value of feature to predict in row %u (see ml_load_options::feature_to_predict)\n", row);
+      return(false);
+    }
+  }
+
+  return(true);  
+}
+
+
+//
+// the best split of the node from the target totals per code of each considered
+// feature: every bin boundary of continuous features (missing values on either 
+// side), each category vs the rest or the best subset of categories (ordered as in
+// add_subset_split_for_discrete_feature) for discrete features. extra-trees try 
+// one random boundary or category per feature.
+//
+bool decision_tree::find_best_prepared_split(dt_prepared_context &context, const ml_vector<ml_uint> &rows, dt_split &best_split, ml_double score) {
+
+  ml_map<ml_uint, bool> random_features_to_consider;
+  if(features_to_consider_per_node_ > 0) {
+    pick_random_features_to_consider(*this, rng_, random_features_to_consider);
+  }
+
+  dt_sparse_totals totals;
+  reset_sparse_totals(*this, totals);
+  for(const auto &row : rows) {
+    add_target_to_sparse_totals(context.targets[row], totals);
+  }
+
+  bool regression = (type_ == ml_model_type::regression);
+  ml_double best_score = std::numeric_limits<ml_double>::max();
+  ml_double best_left_score = 0, best_right_score = 0;
+  ml_uint best_split_code = 0;
+  bool found_split = false;
+
+  dt_sparse_totals left, right;
+
+  //
+  // score the split with the left totals, scores within rounding error are ties
+  //
+  auto consider_split = [&](const dt_sparse_totals &left_totals, const dt_split &split, ml_uint split_code) {
+    if((left_totals.count == 0) || (left_totals.count == totals.count)) {
+      return;
+    }
+
+    right = totals;
+    combine_sparse_totals(right, left_totals, -1);
+
+    ml_double lscore = score_sparse_totals(left_totals);
+    ml_double rscore = score_sparse_totals(right);
+    ml_double combined_score = regression ? (lscore + rscore) :
+      ((((ml_double) left_totals.count / totals.count) * lscore) + (((ml_double) right.count / totals.count) * rscore));
+
+    if(combined_score < (best_score - (fabs(best_score) * DT_SPARSE_SCORE_TOL))) {
+      best_score = combined_score;
+      best_left_score = lscore;
+      best_right_score = rscore;
+      best_split = split;
+      best_split_code = split_code;
+      found_split = true;
+    }
+  };
+
+  for(std::size_t findex = 0; findex < mlid_.size(); ++findex) {
+
+    if(findex == index_of_feature_to_predict_) {
+      continue;
+    }
+
+    if((random_features_to_consider.size() > 0) && (random_features_to_consider.find(findex) == random_features_to_consider.end())) {
+      continue;
+    }
+
+    //
+    // target totals per code of the feature in the node
+    //
+    const ml_vector<uint16_t> &column = context.mlpd.columns[findex];
+    auto &node_codes = context.node_codes;
+    for(const auto &row : rows) {
+      dt_sparse_totals &code_totals = context.code_totals[column[row]];
+      if(code_totals.count == 0) {
+	node_codes.push_back(column[row]);
+      }
+      add_target_to_sparse_totals(context.targets[row], code_totals);
+    }
+
+    std::sort(node_codes.begin(), node_codes.end());
+
+    if(mlid_[findex]->type == ml_feature_type::continuous) {
+
+      const ml_vector<ml_float> &edges = context.mlpd.bin_edges[findex];
+      ml_uint missing_code = context.mlpd.missing_code(findex);
+      bool missing = (node_codes.back() == missing_code);
+      std::size_t value_codes = node_codes.size() - (missing ? 1 : 0);
+
+      dt_split csplit{};
+      csplit.split_feature_index = findex;
+      csplit.split_feature_type = ml_feature_type::continuous;
+      csplit.split_right_op = dt_comparison_op::greaterthan;
+      csplit.split_left_op = dt_comparison_op::lessthanorequal;
+
+      std::size_t random_boundary = value_codes;
+      if(extra_trees_ && (value_codes > 1)) {
+	random_boundary = rng_.random_number() % (value_codes - 1);
+      }
+
+      //
+      // the left side of the boundary after code k holds the values < edges[k]
+      //
+      reset_sparse_totals(*this, left);
+      for(std::size_t ii = 0; ii < value_codes; ++ii) {
+	ml_uint code = node_codes[ii];
+	combine_sparse_totals(left, context.code_totals[code], 1);
+	if((code >= edges.size()) || (extra_trees_ && (ii != random_boundary))) {
+	  continue;
+	}
+
+	csplit.split_feature_value.continuous_value = edges[code];
+	csplit.split_missing_left = false;
+	consider_split(left, csplit, code);
+
+	if(missing) {
+	  dt_sparse_totals missing_left = left;
+	  combine_sparse_totals(missing_left, context.code_totals[missing_code], 1);
+	  csplit.split_missing_left = true;
+	  consider_split(missing_left, csplit, code);
+	}
+      }
+    }
+    else if(node_codes.size() > 1) {
+
+      dt_split dsplit{};
+      dsplit.split_feature_index = findex;
+      dsplit.split_feature_type = ml_feature_type::discrete;
+
+      if(categorical_subset_splits_ && !extra_trees_) {
+	//
+	// categories ordered by mean target (or proportion of the node's majority class), 
+	// the best split of the order is the feature's candidate
+	//
+	ml_uint majority_class = 0;
+	for(ml_uint ii = 0; ii < totals.class_counts.size(); ++ii) {
+	  majority_class = (totals.class_counts[ii] > totals.class_counts[majority_class]) ? ii : majority_class;
+	}
+
+	ml_vector<std::pair<ml_double, ml_uint>> levels;
+	for(const auto &code : node_codes) {
+	  const dt_sparse_totals &code_totals = context.code_totals[code];
+	  ml_double key = regression ? code_totals.sum : code_totals.class_counts[majority_class];
+	  levels.push_back(std::make_pair(key / code_totals.count, code));
+	}
+	std::sort(levels.begin(), levels.end());
+
+	ml_double best_subset_score = std::numeric_limits<ml_double>::max();
+	std::size_t best_left_levels = 0;
+	reset_sparse_totals(*this, left);
+	for(std::size_t ii = 0; ii < (levels.size() - 1); ++ii) {
+	  combine_sparse_totals(left, context.code_totals[levels[ii].second], 1);
+	  right = totals;
+	  combine_sparse_totals(right, left, -1);
+	  ml_double subset_score = regression ? (score_sparse_totals(left) + score_sparse_totals(right)) :
+	    ((((ml_double) left.count / totals.count) * score_sparse_totals(left)) + (((ml_double) right.count / totals.count) * score_sparse_totals(right)));
+	  if(subset_score < best_subset_score) {
+	    best_subset_score = subset_score;
+	    best_left_levels = ii + 1;
+	  }
+	}
+
+	dsplit.split_feature_value.discrete_value_index = levels[0].second;
+	dsplit.split_left_op = dt_comparison_op::in;
+	dsplit.split_right_op = dt_comparison_op::notin;
+	reset_sparse_totals(*this, left);
+	for(std::size_t ii = 0; ii < best_left_levels; ++ii) {
+	  add_category_to_set(dsplit.split_categories, levels[ii].second);
+	  combine_sparse_totals(left, context.code_totals[levels[ii].second], 1);
+	}
+	consider_split(left, dsplit, 0);
+      }
+      else {
+	//
+	// each category vs the rest (one of them with two categories, a random
+	// one for extra-trees)
+	//
+	std::size_t first = extra_trees_ ? (rng_.random_number() % node_codes.size()) : 0;
+	std::size_t last = (extra_trees_ || (node_codes.size() == 2)) ? (first + 1) : node_codes.size();
+	dsplit.split_right_op = dt_comparison_op::equal;
+	dsplit.split_left_op = dt_comparison_op::notequal;
+	for(std::size_t ii = first; ii < last; ++ii) {
+	  dsplit.split_feature_value.discrete_value_index = node_codes[ii];
+	  left = totals;
+	  combine_sparse_totals(left, context.code_totals[node_codes[ii]], -1);
+	  consider_split(left, dsplit, 0);
+	}
+      }
+    }
+
+    for(const auto &code : node_codes) {
+      reset_sparse_totals(*this, context.code_totals[code]);
+    }
+    node_codes.clear();
+  }
+
+  if(found_split) {
+    best_split.left_score = best_left_score;
+    best_split.right_score = best_right_score;
+    context.split_code = best_split_code;
+
+    feature_importance_[best_split.split_feature_index].sum_score_delta += (score - best_score);
+    feature_importance_[best_split.split_feature_index].count += 1;
+
+    return(true);
+  }
+
+  best_split.split_feature_index = 0;
+  best_split.split_left_op = best_split.split_right_op = dt_comparison_op::noop;
+  return(false);
+}
+
+
+void decision_tree::config_prepared_leaf_node(const dt_prepared_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &leaf) {
+  leaves_ += 1;
+  leaf->node_type = dt_node_type::leaf;
+  leaf->feature_index = index_of_feature_to_predict_;
+  leaf->feature_type = mlid_[index_of_feature_to_predict_]->type;
+
+  dt_sparse_totals totals;
+  reset_sparse_totals(*this, totals);
+  for(const auto &row : rows) {
+    add_target_to_sparse_totals(context.targets[row], totals);
+  }
+
+  if(type_ == ml_model_type::regression) {
+    leaf->feature_value.continuous_value = (totals.count > 0) ? (totals.sum / totals.count) : 0.0;
+  }
+  else {
+    config_leaf_node_classes(totals.class_counts, *leaf);
+  }
+
+  if(keep_instances_at_leaf_nodes_) {
+    for(const auto &row : rows) {
+      leaf->leaf_instances.push_back(context.mlpd.mld[row]);
+    }
+  }
+}
+
+
+void decision_tree::build_prepared_tree_node(dt_prepared_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &node, ml_uint depth, ml_double score) {
+  
+  node = std::make_shared<dt_node>();
+  if(!node) {
+    log_error("out of memory. aborting...\n");
+    abort();
+  }
+
+  nodes_ += 1;
+
+  if(depth == max_tree_depth_) {
+    config_prepared_leaf_node(context, rows, node);
+    return;
+  }
+  
+  dt_split best_split = {};
+  ml_vector<ml_uint> left_rows, right_rows;
+
+  if(find_best_prepared_split(context, rows, best_split, score)) {
+    perform_prepared_split(context, rows, best_split, left_rows, right_rows);
+  }
+
+  if((left_rows.size() < min_leaf_instances_) || 
+     (right_rows.size() < min_leaf_instances_)) {
+    config_prepared_leaf_node(context, rows, node);
+    return;
+  }
+
+  config_split_node(best_split, node);
+
+  build_prepared_tree_node(context, left_rows, node->split_left_node, depth+1, best_split.left_score);
+  build_prepared_tree_node(context, right_rows, node->split_right_node, depth+1, best_split.right_score);
+
+  if(prune_twin_leaf_nodes(node)) {
+    config_prepared_leaf_node(context, rows, node);
+  }
+ 
+}
+
+
+bool decision_tree::train(const ml_prepared_data &mlpd) {
+
+  ml_vector<ml_uint> rows(mlpd.size());
+  for(std::size_t ii = 0; ii < rows.size(); ++ii) {
+    rows[ii] = ii;
+  }
+
+  return(train(mlpd, rows));
+}
+
+
+bool decision_tree::train(const ml_prepared_data &mlpd, const ml_vector<ml_uint> &rows) {
+
+  if(!validate_for_training(mlpd, rows)) {
+    return(false);
+  }
+
+  root_ = nullptr;
+  nodes_ = leaves_ = 0;
+  feature_importance_.clear();
+  feature_importance_.resize(mlid_.size());
+
+  dt_prepared_context context{mlpd, {}, {}, {}, 0};
+  context.targets.resize(mlpd.size());
+
+  ml_uint codes = 0;
+  for(std::size_t findex = 0; findex < mlid_.size(); ++findex) {
+    codes = std::max(codes, mlpd.codes(findex));
+  }
+
+  dt_sparse_totals totals;
+  reset_sparse_totals(*this, totals);
+  context.code_totals.resize(codes, totals);
+
+  for(const auto &row : rows) {
+    context.targets[row] = (*mlpd.mld[row])[index_of_feature_to_predict_];
+    add_target_to_sparse_totals(context.targets[row], totals);
+  }
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+  build_prepared_tree_node(context, rows, root_, 0, score_sparse_totals(totals)); 
+  auto t2 = std::chrono::high_resolution_clock::now();
+   
+  ml_uint ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2-t1).count();
+  log("built tree %s in %.3f seconds (%u leaves, %u nodes)\n", name_.c_str(), (ms / 1000.0), leaves_, nodes_); 
+
+  return(true);
+}
+
+
+static ml_string name_for_split_operator(dt_comparison_op op) {
+  
+  ml_string op_name;
+
+  switch(op) {
+  case dt_comparison_op::noop : op_name = "no-op"; break;
+  case dt_comparison_op::lessthanorequal: op_name = "<="; break;
+  case dt_comparison_op::greaterthan: op_name = ">"; break;
+  case dt_comparison_op::equal: op_name = "="; break;
+  case dt_comparison_op::notequal: op_name = "!="; break;
+  case dt_comparison_op::in: op_name = "in"; break;
+  case dt_comparison_op::notin: op_name = "not in"; break;
+  default: log_error("invalid split operator"); break;
+  }
+
+  return(op_name);
+}
+
+
+static void decision_tree_node_desc(const ml_instance_definition &mlid, const dt_node &node, ml_uint depth, ml_string &desc) {
+
+  ml_string feature_value_as_string;
+  if((node.node_type == dt_node_type::split) && !node.split_categories.empty()) {
+    const ml_vector<ml_string> &discrete_values = mlid[node.feature_index]->discrete_values;
+    for(std::size_t ii = 0; ii < discrete_values.size(); ++ii) {
+      if(category_set_contains(node.split_categories, ii)) {
+	feature_value_as_string += (feature_value_as_string.empty() ? "{" : ",") + discrete_values[ii];
+      }
+    }
+    feature_value_as_string += "}";
+  }
+  else if(node.feature_type == ml_feature_type::discrete) {
+    feature_value_as_string = mlid[node.feature_index]->discrete_values[node.feature_value.discrete_value_index];
+  }
+  else {
+    feature_value_as_string = std::to_string(node.feature_value.continuous_value);
+  }
+
+  if(node.node_type == dt_node_type::split) { 
+    // Left Side
+    desc += "\n";
+    for(ml_uint ii=0; ii < depth; ++ii) {
+      desc += "|  ";
+    }
+
+    desc += mlid[node.feature_index]->name + " ";
+    desc += name_for_split_operator(node.split_left_op) + " ";
+    desc += feature_value_as_string;
+    desc += node.split_missing_left ? " or missing" : "";
+    decision_tree_node_desc(mlid, *node.split_left_node, depth+1, desc);
+  
+    // Right Side
+    desc += "\n";
+    for(ml_uint ii=0; ii < depth; ++ii) {
+      desc += "|  ";
+    }
+
+    desc += mlid[node.feature_index]->name + " ";
+    desc += name_for_split_operator(node.split_right_op) + " ";
+    desc += feature_value_as_string;
+    decision_tree_node_desc(mlid, *node.split_right_node, depth+1, desc);
+  }
+  else {
+    // dt_node_type::leaf
+    desc += ": " + feature_value_as_string;
+  }
+  
+}
+  
+
+ml_string decision_tree::summary() const {
+
+  if(mlid_.empty() || !root_) {
+    return("(empty decision tree)\n");
+  }
+
+  ml_string desc;
+  desc += "\n\n*** Decision Tree Summary ***\n\n";
+  desc += "Feature To Predict: " + mlid_[index_of_feature_to_predict_]->name + "\n";
+  ml_string type_str = (type_ == ml_model_type::regression) ? "regression" : "classification";
+  desc += "Type: " + type_str;
+  desc += ", Max Depth: " + std::to_string(max_tree_depth_);
+  desc += ", Min Leaf Instances: " + std::to_string(min_leaf_instances_);
+  if(features_to_consider_per_node_ > 0) {
+    desc += ", Features p/n: " + std::to_string(features_to_consider_per_node_);
+  }
+  if((features_to_consider_per_node_ > 0) || extra_trees_) {
+    desc += ", Seed: " + std::to_string(seed_);
+  }
+  if(extra_trees_) {
+    desc += ", Extra Trees: 1";
+  }
+  
+  desc += ", Leaves: " + std::to_string(leaves_);
+  desc += ", Size: " + std::to_string(nodes_) + "\n";
+  decision_tree_node_desc(mlid_, *root_, 0, desc);
+  desc += "\n\n";
+
+  return(desc);
+}
+
+
+static const dt_node &leaf_node_for_instance(const dt_node &node, const ml_instance &instance) {
+
+  if(node.node_type == dt_node_type::leaf) {
+    return(node);
+  }
+
+  if(instance_satisfies_constraint_of_split(instance, node.feature_index, node.feature_type, node.feature_value, node.split_categories, 
+					    node.split_missing_left, node.split_left_op)) {
+    return(leaf_node_for_instance(*node.split_left_node, instance));
+  }
+
+  return(leaf_node_for_instance(*node.split_right_node, instance));
+}
+
+
+ml_feature_value decision_tree::evaluate(const ml_instance &instance) const {
+
+  ml_feature_value empty = {};
+  if(!root_ || mlid_.empty()) {
+    log_warn("evaluate called on an empty tree...\n");
+    return(empty);
+  }
+
+  if(instance.size() < mlid_.size()) {
+    log_error("feature count mismatch b/t instance definition and instance to evaluate\n");
+    return(empty);
+  }
+
+  return(leaf_node_for_instance(*root_, instance).feature_value);
+}
+
+
+ml_vector<ml_double> decision_tree::predict_proba(const ml_instance &instance) const {
+
+  ml_vector<ml_double> probabilities;
+  if(!root_ || mlid_.empty() || (type_ != ml_model_type::classification)) {
+    log_warn("predict_proba called on an empty or regression tree...\n");
+    return(probabilities);
+  }
+
+  if(instance.size() < mlid_.size()) {
+    log_error("feature count mismatch b/t instance definition and instance to evaluate\n");
+    return(probabilities);
+  }
+
+  const dt_node &leaf = leaf_node_for_instance(*root_, instance);
+  probabilities.assign(mlid_[index_of_feature_to_predict_]->discrete_values.size(), 0.0);
+
+  ml_uint total = 0;
+  for(std::size_t ii = 0; (ii < leaf.leaf_class_counts.size()) && (ii < probabilities.size()); ++ii) {
+    total += leaf.leaf_class_counts[ii];
+  }
+
+  if(total == 0) {
+    if(leaf.feature_value.discrete_value_index < probabilities.size()) {
+      probabilities[leaf.feature_value.discrete_value_index] = 1.0;
+    }
+    return(probabilities);
+  }
+
+  for(std::size_t ii = 0; (ii < leaf.leaf_class_counts.size()) && (ii < probabilities.size()); ++ii) {
+    probabilities[ii] = (ml_double) leaf.leaf_class_counts[ii] / total;
+  }
+
+  return(probabilities);
+}
+
+
+static const ml_feature_value evaluate_decision_tree_node_for_sparse_row(const dt_node &node, const ml_sparse_data &mlsd, std::size_t row) {
+
+  if(node.node_type == dt_node_type::leaf) {
+    return(node.feature_value);
+  }
+
+  if(sparse_row_satisfies_constraint_of_split(mlsd, row, node.feature_index, node.feature_type, node.feature_value, node.split_categories, 
+					    node.split_missing_left, node.split_left_op)) {
+    return(evaluate_decision_tree_node_for_sparse_row(*node.split_left_node, mlsd, row));
+  }
+
+  return(evaluate_decision_tree_node_for_sparse_row(*node.split_right_node, mlsd, row));
+}
+
+
+ml_feature_value decision_tree::evaluate(const ml_sparse_data &mlsd, std::size_t row) const {
+
+  ml_feature_value empty = {};
+  if(!root_ || mlid_.empty()) {
+    log_warn("evaluate called on an empty tree...\n");
+    return(empty);
+  }
+
+  if(row >= mlsd.size()) {
+    log_error("invalid row index to evaluate: %zu\n", row);
+    return(empty);
+  }
+
+  return(evaluate_decision_tree_node_for_sparse_row(*root_, mlsd, row));
+}
 
   
 void add_nodes_to_json_object(const dt_node &node, json &json_nodes, ml_uint &node_id) {
@@ -759,6 +2080,24 @@ void add_nodes_to_json_object(const dt_node &node, json &json_nodes, ml_uint &no
     add_nodes_to_json_object(*node.split_right_node, json_nodes, node_id);
   }
 
+  if(!node.split_categories.empty()) {
+    json json_categories = json::array();
+    for(ml_uint ii = 0; ii < (node.split_categories.size() * 64); ++ii) {
+      if(category_set_contains(node.split_categories, ii)) {
+	json_categories.push_back(ii);
+      }
+    }
+    anode["cs"] = json_categories;
+  }
+
+  if(node.split_missing_left) {
+    anode["ml"] = node.split_missing_left;
+  }
+
+  if(!node.leaf_class_counts.empty()) {
+    anode["cc"] = node.leaf_class_counts;
+  }
+
   json_nodes.push_back(anode);
 
 }
@@ -801,6 +2140,11 @@ static bool create_tree_node_from_json(dt_node_ptr &node, ml_uint node_id, ml_ma
 
   if(node->node_type == dt_node_type::leaf) {
     leaves += 1;
+
+    // class counts of classification leaves (not present in older models)
+    if(json_node.contains<ml_string>("cc") && json_node["cc"].is_array()) {
+      node->leaf_class_counts = json_node["cc"].get<ml_vector<ml_uint>>();
+    }
   }
   else {
 
@@ -816,6 +2160,15 @@ static bool create_tree_node_from_json(dt_node_ptr &node, ml_uint node_id, ml_ma
     node->split_left_op = (dt_comparison_op) left_node_op;
     node->split_right_op = (dt_comparison_op) right_node_op;
 
+    // missing values side and categories of subset splits (not present in older models)
+    get_bool_value_from_json(json_node, "ml", node->split_missing_left);
+    if(json_node.contains<ml_string>("cs") && json_node["cs"].is_array()) {
+      const json &categories_array = json_node["cs"];
+      for(ml_uint ii = 0; ii < categories_array.size(); ++ii) {
+	add_category_to_set(node->split_categories, categories_array[ii]);
+      }
+    }
+
     if(!create_tree_node_from_json(node->split_left_node, left_node_id, nodes_map, nodes, leaves) ||
        !create_tree_node_from_json(node->split_right_node, right_node_id, nodes_map, nodes, leaves)) {
       return(false);
@@ -849,6 +2202,10 @@ bool decision_tree::create_decision_tree_from_json(const json &json_object) {
     return(false);
   }
 
+  // optional (not present in older models)
+  get_bool_value_from_json(json_object, "categorical_subset_splits", categorical_subset_splits_);
+  get_bool_value_from_json(json_object, "extra_trees", extra_trees_);
+
   if(!json_object.contains<ml_string>("nodes")) {
     log_error("json object is missing a nodes array\n");
     return(false);
@@ -902,6 +2259,8 @@ bool decision_tree::save(const ml_string &path, bool part_of_ensemble) const {
     {"features_to_consider_per_node", features_to_consider_per_node_},
     {"seed", seed_},
     {"keep_instances_at_leaf_nodes", keep_instances_at_leaf_nodes_},
+    {"categorical_subset_splits", categorical_subset_splits_},
+    {"extra_trees", extra_trees_},
     {"nodes", json_nodes}
   };
 
@@ -39,9 +39,17 @@ enum class dt_comparison_op : ml_uint {
   greaterthan,
   equal,
   notequal,
+  in,
+  notin,
 };
 
 
+//
+// a set of discrete value indexes (bitset) for categorical subset splits
+//
+using dt_category_set = ml_vector<uint64_t>;
+
+
 struct dt_node;
 using dt_node_ptr = std::shared_ptr<dt_node>;
 
@@ -56,6 +64,11 @@ struct dt_node {
 
   dt_comparison_op split_right_op;    
   dt_node_ptr split_right_node = nullptr;
+
+  dt_category_set split_categories; // categories of the left node (in/notin splits)
+  bool split_missing_left = false; // missing (NaN) continuous values go to the left node
+
+  ml_vector<ml_uint> leaf_class_counts; // training instances per category at classification leaf nodes
   
   ml_data leaf_instances;
 };
@@ -67,6 +80,8 @@ struct dt_feature_importance {
 };
 
 struct dt_split;
+struct dt_sparse_context;
+struct dt_prepared_context;
 
 class decision_tree final {
 
@@ -107,6 +122,27 @@ class decision_tree final {
   //
   bool train(const ml_data &mld);
 
+  // (the tree's root node holds the rows of the view)
+  bool train(const ml_data_view &mld) { return(train(mld.to_data())); }
+
+  //
+  // Build the tree from sparse data (all rows, or the given rows which may repeat).
+  // Features other than the one to predict must be continuous. Splits are found by 
+  // iterating the non-zero values of each feature, zeros are accounted for with 
+  // the totals of the node.
+  //
+  bool train(const ml_sparse_data &mlsd);
+  bool train(const ml_sparse_data &mlsd, const ml_vector<ml_uint> &rows);
+
+  //
+  // Build the tree from prepared (quantized) data, all rows or the given rows which
+  // may repeat. Splits are found from the target totals per bin (or category) of
+  // each feature in a node and every bin boundary is a candidate threshold. The
+  // thresholds are feature values, so the tree evaluates instances as usual.
+  //
+  bool train(const ml_prepared_data &mlpd);
+  bool train(const ml_prepared_data &mlpd, const ml_vector<ml_uint> &rows);
+
   //
   // Evaluate the tree for the given instance and return the prediction as a ml_feature_value.
   // Use the continuous_value of the returned ml_feature_value if this is a regression tree,
@@ -120,6 +156,19 @@ class decision_tree final {
   //
   ml_feature_value evaluate(const ml_instance &instance) const;
 
+  //
+  // Evaluate the tree for a row of sparse data
+  //
+  ml_feature_value evaluate(const ml_sparse_data &mlsd, std::size_t row) const;
+
+  //
+  // Class probabilities for the given instance (classification trees): the proportion
+  // of each category (by discrete_value_index) among the training instances of the
+  // instance's leaf. Trees restored from models saved without leaf class counts give 
+  // 1 for the predicted category. Empty for regression trees.
+  //
+  ml_vector<ml_double> predict_proba(const ml_instance &instance) const;
+
   // 
   // Summary includes tree type, structure, etc
   //
@@ -137,6 +186,24 @@ class decision_tree final {
   void set_name(const ml_string &name) { name_ = name; }
   void set_seed(ml_uint seed) { seed_ = seed; rng_ = ml_rng{seed}; }
   void set_max_tree_depth(ml_uint depth) { max_tree_depth_ = depth; }
+
+  //
+  // Split discrete features into two subsets of categories (in/not in) instead of 
+  // one category vs the rest (equal/not equal). The categories are ordered by their
+  // mean target value (or the proportion of the most frequent class) and the best 
+  // split of that order is used, so high cardinality features need fewer nodes.
+  //
+  void set_categorical_subset_splits(bool subset_splits) { categorical_subset_splits_ = subset_splits; }
+  bool categorical_subset_splits() const { return(categorical_subset_splits_); }
+
+  //
+  // Extremely randomized trees: each feature considered at a node gets a single 
+  // split at a uniformly random threshold between its min and max in the node 
+  // (a random category, or subset of categories, for discrete features) and the 
+  // best of those splits is used. Much faster to train than the threshold search.
+  //
+  void set_extra_trees(bool extra_trees) { extra_trees_ = extra_trees; }
+  bool extra_trees() const { return(extra_trees_); }
   
 
  private:
@@ -149,6 +216,8 @@ class decision_tree final {
   ml_uint features_to_consider_per_node_ = 0; 
   ml_uint seed_ = ML_DEFAULT_SEED;
   bool keep_instances_at_leaf_nodes_ = false;
+  bool categorical_subset_splits_ = false;
+  bool extra_trees_ = false;
 
   // tree structure
   ml_model_type type_;
@@ -167,6 +236,14 @@ class decision_tree final {
   void config_leaf_node(const ml_data &mld, dt_node_ptr &leaf);
   bool prune_twin_leaf_nodes(dt_node_ptr &node);
   bool find_best_split(const ml_data &mld, dt_split &best_split, ml_double score);
+  bool validate_for_training(const ml_sparse_data &mlsd, const ml_vector<ml_uint> &rows);
+  void build_sparse_tree_node(dt_sparse_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &node, ml_uint depth, ml_double score);
+  void config_sparse_leaf_node(const dt_sparse_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &leaf);
+  bool find_best_sparse_split(dt_sparse_context &context, const ml_vector<ml_uint> &rows, dt_split &best_split, ml_double score);
+  bool validate_for_training(const ml_prepared_data &mlpd, const ml_vector<ml_uint> &rows);
+  void build_prepared_tree_node(dt_prepared_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &node, ml_uint depth, ml_double score);
+  void config_prepared_leaf_node(const dt_prepared_context &context, const ml_vector<ml_uint> &rows, dt_node_ptr &leaf);
+  bool find_best_prepared_split(dt_prepared_context &context, const ml_vector<ml_uint> &rows, dt_split &best_split, ml_double score);
   bool create_decision_tree_from_json(const json &json_object);
 };
 
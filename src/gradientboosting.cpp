@@ -0,0 +1,522 @@
+/*
+Copyright (c) Carl Sherrell
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+#include "gradientboosting.h"
+#include "mlutil.h"
+
+namespace puml {
+
+static const ml_string &GB_BASEINFO_FILE = "gb.json";
+static const ml_string &GB_MLID_FILE = "mlid.json";
+
+static const ml_double GB_MIN_HESSIAN = 0.000001;
+static const ml_double GB_MIN_PROBABILITY = 0.000001;
+
+
+gradient_boosting::gradient_boosting(const ml_instance_definition &mlid,
+				     const ml_string &feature_to_predict,
+				     ml_uint number_of_rounds,
+				     ml_double learning_rate,
+				     ml_uint max_tree_depth,
+				     ml_uint min_leaf_instances,
+				     ml_uint seed) :
+  mlid_(mlid),
+  index_of_feature_to_predict_(index_of_feature_with_name(feature_to_predict, mlid)),
+  number_of_rounds_(number_of_rounds),
+  learning_rate_(learning_rate),
+  max_tree_depth_(max_tree_depth),
+  min_leaf_instances_(min_leaf_instances),
+  seed_(seed) {
+
+  type_ = (mlid_[index_of_feature_to_predict_]->type == ml_feature_type::discrete) ? ml_model_type::classification : ml_model_type::regression;
+  init_classes();
+}
+
+
+//
+// the classes are the known categories of the feature to predict
+// (the unknown category, index 0, isn't predicted)
+//
+void gradient_boosting::init_classes() {
+  classes_.clear();
+  if(type_ != ml_model_type::classification) {
+    return;
+  }
+
+  for(ml_uint ii = 1; ii < mlid_[index_of_feature_to_predict_]->discrete_values.size(); ++ii) {
+    classes_.push_back(ii);
+  }
+}
+
+
+ml_uint gradient_boosting::scores_per_round() const {
+  return((classes_.size() > 2) ? classes_.size() : 1);
+}
+
+
+static ml_double sigmoid(ml_double score) {
+  if(score >= 0) {
+    return(1.0 / (1.0 + std::exp(-score)));
+  }
+  ml_double e = std::exp(score);
+  return(e / (1.0 + e));
+}
+
+
+static void softmax(const ml_double *scores, ml_uint count, ml_vector<ml_double> &probabilities) {
+  ml_double max_score = *std::max_element(scores, scores + count);
+  ml_double sum = 0;
+  probabilities.resize(count);
+  for(ml_uint ii = 0; ii < count; ++ii) {
+    probabilities[ii] = std::exp(scores[ii] - max_score);
+    sum += probabilities[ii];
+  }
+
+  for(auto &probability : probabilities) {
+    probability /= sum;
+  }
+}
+
+
+//
+// the rows (drawn without replacement) that a boosting round trains on
+//
+static void sample_rows_for_round(std::size_t size, ml_double subsample, ml_rng &rng, ml_vector<ml_uint> &rows) {
+
+  ml_vector<ml_uint> indices(size);
+  for(std::size_t ii = 0; ii < indices.size(); ++ii) {
+    indices[ii] = ii;
+  }
+
+  if(subsample >= 1.0) {
+    rows = indices;
+    return;
+  }
+
+  std::size_t sample_size = (std::size_t) ((subsample * size) + 0.5);
+  sample_size = std::min(std::max(sample_size, (std::size_t) 1), size);
+
+  rows.clear();
+  for(std::size_t ii = 0; ii < sample_size; ++ii) {
+    std::swap(indices[ii], indices[ii + (rng.random_number() % (indices.size() - ii))]);
+    rows.push_back(indices[ii]);
+  }
+}
+
+
+//
+// replace the mean of the leaf instances at each leaf of a tree with the newton
+// step, scale * (sum of residuals / sum of hessians), of the instances (whose
+// row is in the slot after their features, see train())
+//
+static void set_newton_leaf_values(dt_node &node, ml_uint row_slot,
+				   const ml_vector<ml_double> &residuals, const ml_vector<ml_double> &hessians,
+				   ml_double scale) {
+
+  if(node.node_type == dt_node_type::split) {
+    set_newton_leaf_values(*node.split_left_node, row_slot, residuals, hessians, scale);
+    set_newton_leaf_values(*node.split_right_node, row_slot, residuals, hessians, scale);
+    return;
+  }
+
+  ml_double sum_residuals = 0, sum_hessians = 0;
+  for(const auto &inst_ptr : node.leaf_instances) {
+    ml_uint row = (*inst_ptr)[row_slot].discrete_value_index;
+    sum_residuals += residuals[row];
+    sum_hessians += hessians[row];
+  }
+
+  node.feature_value.continuous_value = scale * (sum_residuals / std::max(sum_hessians, GB_MIN_HESSIAN));
+  node.leaf_instances = ml_data();
+}
+
+
+bool gradient_boosting::train(const ml_data_view &mld) {
+
+  trees_.clear();
+  base_scores_.clear();
+
+  if(mlid_.empty() || mld.empty()) {
+    log_error("gb train() invalid instance definition or empty data...\n");
+    return(false);
+  }
+
+  if((learning_rate_ <= 0.0) || (subsample_ <= 0.0) || (subsample_ > 1.0)) {
+    log_error("gb train() learning rate must be > 0 and subsample in (0,1]\n");
+    return(false);
+  }
+
+  init_classes();
+  if((type_ == ml_model_type::classification) && (classes_.size() < 2)) {
+    log_error("gb train() needs at least two classes to predict\n");
+    return(false);
+  }
+
+  //
+  // the trees are regression trees of the gradient, so they're trained with copies
+  // (made once) of the instances whose feature to predict is replaced by the residual
+  // (negative gradient) of the current round. each copy holds its row in an extra
+  // slot after the features, for the leaf values. instances without a known class
+  // or value (see ml_load_options::keep_missing) are skipped.
+  //
+  ml_instance_definition gradient_mlid(mlid_);
+  ml_feature_desc_ptr gradient_desc = std::make_shared<ml_feature_desc>();
+  gradient_desc->type = ml_feature_type::continuous;
+  gradient_desc->name = mlid_[index_of_feature_to_predict_]->name;
+  gradient_mlid[index_of_feature_to_predict_] = gradient_desc;
+
+  ml_data gradient_mld;
+  ml_vector<ml_double> targets;
+  ml_uint row_slot = mlid_.size();
+  for(std::size_t instance_index = 0; instance_index < mld.size(); ++instance_index) {
+    const ml_instance_ptr &inst_ptr = mld[instance_index];
+    if(inst_ptr->size() < row_slot) {
+      log_error("gb train() feature count mismatch b/t instance definition and instance data\n");
+      return(false);
+    }
+
+    const ml_feature_value &target = (*inst_ptr)[index_of_feature_to_predict_];
+    if(type_ == ml_model_type::classification) {
+      if(target.discrete_value_index == 0) {
+	continue;
+      }
+      targets.push_back(target.discrete_value_index - 1); // position in classes_
+    }
+    else {
+      if(std::isnan(target.continuous_value)) {
+	continue;
+      }
+      targets.push_back(target.continuous_value);
+    }
+
+    ml_instance_ptr gradient_inst_ptr = std::make_shared<ml_instance>();
+    gradient_inst_ptr->reserve(row_slot + 1);
+    gradient_inst_ptr->assign(inst_ptr->begin(), inst_ptr->begin() + row_slot);
+    gradient_inst_ptr->push_back(ml_feature_value{});
+    (*gradient_inst_ptr)[row_slot].discrete_value_index = gradient_mld.size();
+    gradient_mld.push_back(gradient_inst_ptr);
+  }
+
+  if(gradient_mld.empty()) {
+    log_error("gb train() no instances with a known value to predict\n");
+    return(false);
+  }
+
+  //
+  // initial scores: the mean for regression, the log odds (or log of the class
+  // proportions) for classification
+  //
+  std::size_t size = gradient_mld.size();
+  ml_uint nscores = scores_per_round();
+  if(type_ == ml_model_type::regression) {
+    ml_double sum = 0;
+    for(const auto &target : targets) {
+      sum += target;
+    }
+    base_scores_.push_back(sum / size);
+  }
+  else {
+    ml_vector<ml_double> class_counts(classes_.size(), 0);
+    for(const auto &target : targets) {
+      class_counts[(ml_uint) target] += 1;
+    }
+
+    if(nscores == 1) {
+      ml_double p = std::min(std::max(class_counts[1] / size, GB_MIN_PROBABILITY), 1.0 - GB_MIN_PROBABILITY);
+      base_scores_.push_back(std::log(p / (1.0 - p)));
+    }
+    else {
+      for(const auto &count : class_counts) {
+	base_scores_.push_back(std::log(std::max(count / size, GB_MIN_PROBABILITY)));
+      }
+    }
+  }
+
+  ml_vector<ml_double> scores(size * nscores);
+  for(std::size_t row = 0; row < size; ++row) {
+    std::copy(base_scores_.begin(), base_scores_.end(), scores.begin() + (row * nscores));
+  }
+
+  ml_rng rng(seed_);
+  ml_vector<ml_vector<ml_double>> residuals(nscores, ml_vector<ml_double>(size, 0));
+  ml_vector<ml_vector<ml_double>> hessians(nscores, ml_vector<ml_double>(size, 1.0));
+  ml_vector<ml_double> probabilities;
+  ml_vector<ml_uint> sample;
+  ml_data round_mld;
+
+  // softmax leaf values are scaled by (K-1)/K (friedman's multiclass newton step)
+  ml_double leaf_scale = learning_rate_ * ((nscores > 1) ? ((nscores - 1.0) / nscores) : 1.0);
+
+  for(ml_uint round = 0; round < number_of_rounds_; ++round) {
+
+    log("\nboosting round %d...\n", round + 1);
+
+    //
+    // gradients and hessians of the loss for the scores before the round
+    //
+    for(std::size_t row = 0; row < size; ++row) {
+      const ml_double *row_scores = &scores[row * nscores];
+      if(type_ == ml_model_type::regression) {
+	residuals[0][row] = targets[row] - row_scores[0];
+      }
+      else if(nscores == 1) {
+	ml_double p = sigmoid(row_scores[0]);
+	residuals[0][row] = ((targets[row] == 1) ? 1.0 : 0.0) - p;
+	hessians[0][row] = p * (1.0 - p);
+      }
+      else {
+	softmax(row_scores, nscores, probabilities);
+	for(ml_uint kk = 0; kk < nscores; ++kk) {
+	  residuals[kk][row] = ((targets[row] == kk) ? 1.0 : 0.0) - probabilities[kk];
+	  hessians[kk][row] = probabilities[kk] * (1.0 - probabilities[kk]);
+	}
+      }
+    }
+
+    sample_rows_for_round(size, subsample_, rng, sample);
+
+    round_mld.clear();
+    for(const auto &row : sample) {
+      round_mld.push_back(gradient_mld[row]);
+    }
+
+    for(ml_uint kk = 0; kk < nscores; ++kk) {
+
+      for(std::size_t row = 0; row < size; ++row) {
+	(*gradient_mld[row])[index_of_feature_to_predict_].continuous_value = residuals[kk][row];
+      }
+
+      decision_tree tree{gradient_mlid, index_of_feature_to_predict_,
+	  max_tree_depth_, min_leaf_instances_, features_to_consider_per_node_,
+	  seed_ + (ml_uint) trees_.size(), true};
+
+      if(!tree.train(round_mld)) {
+	log_error("gb failed to build decision tree...\n");
+	trees_.clear();
+	return(false);
+      }
+
+      set_newton_leaf_values(*tree.root(), row_slot, residuals[kk], hessians[kk], leaf_scale);
+
+      for(std::size_t row = 0; row < size; ++row) {
+	scores[(row * nscores) + kk] += tree.evaluate(*gradient_mld[row]).continuous_value;
+      }
+
+      trees_.push_back(tree);
+    }
+  }
+
+  return(true);
+}
+
+
+void gradient_boosting::evaluate_scores(const ml_instance &instance, ml_vector<ml_double> &scores) const {
+  scores = base_scores_;
+  for(std::size_t ii = 0; ii < trees_.size(); ++ii) {
+    scores[ii % scores.size()] += trees_[ii].evaluate(instance).continuous_value;
+  }
+}
+
+
+ml_feature_value gradient_boosting::evaluate(const ml_instance &instance) const {
+
+  ml_feature_value gb_eval = {};
+
+  if(base_scores_.empty()) {
+    log_warn("evaluate() called on an untrained model\n");
+    return(gb_eval);
+  }
+
+  ml_vector<ml_double> scores;
+  evaluate_scores(instance, scores);
+
+  if(type_ == ml_model_type::regression) {
+    gb_eval.continuous_value = scores[0];
+  }
+  else if(scores.size() == 1) {
+    gb_eval.discrete_value_index = classes_[(scores[0] > 0.0) ? 1 : 0];
+  }
+  else {
+    gb_eval.discrete_value_index = classes_[std::max_element(scores.begin(), scores.end()) - scores.begin()];
+  }
+
+  return(gb_eval);
+}
+
+
+bool gradient_boosting::write_gradient_boosting_base_info_to_file(const ml_string &path) const {
+
+  json json_object = {{"object", "gradient_boosting"},
+		      {"version", ML_VERSION_STRING},
+		      {"type", type_},
+		      {"index_of_feature_to_predict", index_of_feature_to_predict_},
+		      {"number_of_rounds", number_of_rounds_},
+		      {"learning_rate", learning_rate_},
+		      {"max_tree_depth", max_tree_depth_},
+		      {"min_leaf_instances", min_leaf_instances_},
+		      {"features_to_consider_per_node", features_to_consider_per_node_},
+		      {"subsample", subsample_},
+		      {"seed", seed_},
+		      {"number_of_trees", trees_.size()},
+		      {"base_scores", base_scores_}};
+
+  std::ofstream modelout(path);
+  modelout << std::setw(4) << json_object << std::endl;
+  return(modelout.good());
+}
+
+
+bool gradient_boosting::save(const ml_string &path) const {
+
+  if(mlid_.empty()) {
+    return(false);
+  }
+
+  if(!prepare_directory_for_model_save(path)) {
+    return(false);
+  }
+
+  if(!write_instance_definition_to_file(path + "/" + GB_MLID_FILE, mlid_)) {
+    log_error("couldn't write gb instance definition to %s\n", GB_MLID_FILE.c_str());
+    return(false);
+  }
+
+  if(!write_gradient_boosting_base_info_to_file(path + "/" + GB_BASEINFO_FILE)) {
+    log_error("couldn't write gb info to %s\n", GB_BASEINFO_FILE.c_str());
+    return(false);
+  }
+
+  // the trees are summed in order, so each tree's file is named by its index
+  for(std::size_t ii = 0; ii < trees_.size(); ++ii) {
+    ml_string filename = path + "/" + puml::TREE_MODEL_FILE_PREFIX + std::to_string(ii+1) + ".json";
+    if(!trees_[ii].save(filename, true)) {
+      log_error("couldn't write tree to file: %s\n", filename.c_str());
+      return(false);
+    }
+  }
+
+  return(true);
+}
+
+
+bool gradient_boosting::read_gradient_boosting_base_info_from_file(const ml_string &path) {
+
+  std::ifstream jsonfile(path);
+  json json_object;
+  jsonfile >> json_object;
+
+  ml_string object_name = json_object["object"];
+  if(object_name != "gradient_boosting") {
+    log_error("json object is not a gradient boosting model...\n");
+    return(false);
+  }
+
+  ml_uint number_of_trees = 0;
+  if(!(get_modeltype_value_from_json(json_object, "type", type_) &&
+       get_numeric_value_from_json(json_object, "index_of_feature_to_predict", index_of_feature_to_predict_) &&
+       get_numeric_value_from_json(json_object, "number_of_rounds", number_of_rounds_) &&
+       get_double_value_from_json(json_object, "learning_rate", learning_rate_) &&
+       get_numeric_value_from_json(json_object, "max_tree_depth", max_tree_depth_) &&
+       get_numeric_value_from_json(json_object, "min_leaf_instances", min_leaf_instances_) &&
+       get_numeric_value_from_json(json_object, "features_to_consider_per_node", features_to_consider_per_node_) &&
+       get_double_value_from_json(json_object, "subsample", subsample_) &&
+       get_numeric_value_from_json(json_object, "seed", seed_) &&
+       get_numeric_value_from_json(json_object, "number_of_trees", number_of_trees))) {
+    return(false);
+  }
+
+  if(!json_object.contains<ml_string>("base_scores") || !json_object["base_scores"].is_array()) {
+    log_error("gb json is missing the base scores\n");
+    return(false);
+  }
+
+  base_scores_ = json_object["base_scores"].get<ml_vector<ml_double>>();
+
+  trees_.clear();
+  trees_.resize(number_of_trees);
+
+  return(true);
+}
+
+
+bool gradient_boosting::restore(const ml_string &path) {
+
+  if(!read_instance_definition_from_file(path + "/" + GB_MLID_FILE, mlid_)) {
+    log_error("couldn't read gb instance defintion\n");
+    return(false);
+  }
+
+  if(!read_gradient_boosting_base_info_from_file(path + "/" + GB_BASEINFO_FILE)) {
+    log_error("couldn't read gb base info\n");
+    return(false);
+  }
+
+  init_classes();
+  if(base_scores_.size() != scores_per_round()) {
+    log_error("gb base scores don't match the feature to predict\n");
+    return(false);
+  }
+
+  for(std::size_t ii = 0; ii < trees_.size(); ++ii) {
+    ml_string filename = path + "/" + puml::TREE_MODEL_FILE_PREFIX + std::to_string(ii+1) + ".json";
+    if(!trees_[ii].restore(filename, mlid_)) {
+      log_error("couldn't read tree from file: %s\n", filename.c_str());
+      trees_.clear();
+      return(false);
+    }
+  }
+
+  return(true);
+}
+
+
+ml_string gradient_boosting::summary() const {
+
+  if(mlid_.empty() || trees_.empty()) {
+    return("(empty model)\n");
+  }
+
+  ml_string desc;
+  desc += "\n\n*** Gradient Boosting Summary ***\n\n";
+  desc += "Feature To Predict: " + mlid_[index_of_feature_to_predict_]->name + "\n";
+  ml_string type_str = (type_ == ml_model_type::regression) ? "regression" : "classification";
+  desc += "Type: " + type_str;
+  desc += ", Rounds: " + std::to_string(number_of_rounds_);
+  desc += ", Trees: " + std::to_string(trees_.size());
+  desc += ", Learning Rate: " + std::to_string(learning_rate_);
+  desc += ", Max Depth: " + std::to_string(max_tree_depth_);
+  desc += ", Min Leaf Instances: " + std::to_string(min_leaf_instances_);
+  desc += ", Features p/n: " + std::to_string(features_to_consider_per_node_);
+  desc += ", Subsample: " + std::to_string(subsample_);
+  desc += ", Seed: " + std::to_string(seed_);
+  desc += "\n";
+
+  return(desc);
+}
+
+
+} // namespace puml
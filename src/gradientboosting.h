@@ -0,0 +1,115 @@
+/*
+Copyright (c) Carl Sherrell
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "decisiontree.h"
+
+namespace puml {
+
+//
+// Gradient boosted trees. Each boosting round fits small regression trees
+// (decision_tree) to the gradient of the loss and sets their leaf values with
+// a newton step (sum of gradients / sum of hessians of the leaf instances),
+// scaled by the learning rate. Regression uses squared error, classification
+// uses logistic loss for two classes and softmax (one tree per class and round)
+// for more.
+//
+class gradient_boosting final {
+
+ public:
+
+  static const ml_uint GB_DEFAULT_DEPTH = 6;
+  static const ml_uint GB_DEFAULT_MININST = 2;
+
+  gradient_boosting(const ml_string &path) { restore(path); }
+
+  gradient_boosting(const ml_instance_definition &mlid,
+		    const ml_string &feature_to_predict,
+		    ml_uint number_of_rounds,
+		    ml_double learning_rate = 0.1,
+		    ml_uint max_tree_depth = GB_DEFAULT_DEPTH,
+		    ml_uint min_leaf_instances = GB_DEFAULT_MININST,
+		    ml_uint seed = ML_DEFAULT_SEED);
+
+  bool save(const ml_string &path) const;
+  bool restore(const ml_string &path);
+
+  bool train(const ml_data &mld) { return(train(ml_data_view(mld))); }
+  bool train(const ml_data_view &mld);
+
+  ml_feature_value evaluate(const ml_instance &instance) const;
+
+  ml_string summary() const;
+
+  const ml_instance_definition &mlid() const { return(mlid_); }
+  const ml_vector<decision_tree> &trees() const { return(trees_); }
+  ml_uint index_of_feature_to_predict() const { return(index_of_feature_to_predict_); }
+  ml_model_type type() const { return(type_); }
+
+  void set_seed(ml_uint seed) { seed_ = seed; }
+  void set_number_of_rounds(ml_uint rounds) { number_of_rounds_ = rounds; }
+  void set_learning_rate(ml_double learning_rate) { learning_rate_ = learning_rate; }
+
+  //
+  // Row subsampling: each round trains on a fraction, in (0,1], of the training
+  // rows drawn without replacement (default 1.0, all rows).
+  //
+  void set_subsample(ml_double subsample) { subsample_ = subsample; }
+
+  //
+  // Column subsampling: the number of random features considered at each node
+  // (see decision_tree). 0 (default) considers all features.
+  //
+  void set_features_to_consider_per_node(ml_uint features) { features_to_consider_per_node_ = features; }
+
+ private:
+
+  // build parameters
+  ml_instance_definition mlid_;
+  ml_uint index_of_feature_to_predict_ = 0;
+  ml_uint number_of_rounds_ = 0;
+  ml_double learning_rate_ = 0.1;
+  ml_uint max_tree_depth_ = 0;
+  ml_uint min_leaf_instances_ = 0;
+  ml_uint features_to_consider_per_node_ = 0;
+  ml_double subsample_ = 1.0;
+  ml_uint seed_ = ML_DEFAULT_SEED;
+
+  // model structure. the trees of a round are consecutive, one per score
+  // (the scores are the log odds of classes_[1] for two classes, one per class
+  // in classes_ for more and the predicted value for regression)
+  ml_model_type type_;
+  ml_vector<ml_uint> classes_;
+  ml_vector<ml_double> base_scores_;
+  ml_vector<decision_tree> trees_;
+
+  // implementation
+  ml_uint scores_per_round() const;
+  void init_classes();
+  void evaluate_scores(const ml_instance &instance, ml_vector<ml_double> &scores) const;
+  bool write_gradient_boosting_base_info_to_file(const ml_string &path) const;
+  bool read_gradient_boosting_base_info_from_file(const ml_string &path);
+};
+
+
+} // namespace puml
@@ -22,16 +22,22 @@ SOFTWARE.
 
 #include "mldata.h"
 #include "mlutil.h"
-#include "rapidcsv.h"
 
 #include <iostream>
 #include <algorithm>
+#include <fstream>
+#include <iomanip>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <random>
 #include <chrono>
+#include <deque>
+#include <thread>
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 
 
@@ -43,18 +49,22 @@ const ml_string ML_UNKNOWN_DISCRETE_CATEGORY = "<unknown>";
 const ml_float MISSING_CONTINUOUS_FEATURE_VALUE = std::numeric_limits<ml_float>::lowest();
 const ml_uint ML_DEFAULT_SEED = 999;
 
+static const char ML_CSV_DELIM = ',';
+static const std::size_t ML_LOAD_MIN_CHUNK_BYTES = 1 << 20;
+static const std::size_t ML_LOAD_BATCH_BYTES = 4 << 20; // per thread, for files that are read in batches
+
 //
 // one per feature, used for online avg/variance calc 
 // and to track which instances have missing data
 //
-typedef struct {
+struct ml_stats_helper {
   ml_uint count;
   ml_double mean;
   ml_double M2;
 
   ml_vector<ml_uint> missing_data_instance_indices;
 
-} ml_stats_helper;
+};
 
 
 static ml_string stringTrimLeadingTrailingWhitespace(ml_string &str) {
@@ -174,12 +184,387 @@ static void updateStatsHelperWithFeatureValue(ml_stats_helper &stats_helper, con
   stats_helper.M2 = stats_helper.M2 + (delta * (mlfv.continuous_value - stats_helper.mean));
 }
 
-static bool processInstanceFeatures(ml_instance_definition &mlid, ml_data &mld, const ml_vector<ml_string> &features_as_string, 
-				    ml_vector<ml_stats_helper> &stats_helper, const ml_map<ml_uint, bool> &ignored_features) {  
+//
+// a field within a line of csv text. quoted fields ("...") are stored 
+// without the surrounding quotes and have any escaped quotes ("") replaced
+// when converted to a string.
+//
+struct ml_csv_field {
+  const char *begin;
+  const char *end;
+  bool quoted;
+};
+
+
+//
+// a non-owning reference to characters of the input text (or a string that
+// outlives the reference). used to look up values without creating strings.
+//
+struct ml_string_ref {
+  const char *data;
+  std::size_t size;
+
+  bool operator==(const ml_string_ref &other) const {
+    return((size == other.size) && (memcmp(data, other.data, size) == 0));
+  }
+};
+
+
+struct ml_string_ref_hash {
+  std::size_t operator()(const ml_string_ref &ref) const {
+    // fnv-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for(std::size_t ii = 0; ii < ref.size; ++ii) {
+      hash ^= (unsigned char) ref.data[ii];
+      hash *= 1099511628211ULL;
+    }
+    return((std::size_t) hash);
+  }
+};
+
+
+static ml_csv_field csvFieldForRange(const char *begin, const char *end) {
+  ml_csv_field field = {begin, end, false};
+  if(((end - begin) >= 2) && (*begin == '"') && (*(end - 1) == '"')) {
+    field.begin = begin + 1;
+    field.end = end - 1;
+    field.quoted = true;
+  }
+
+  return(field);
+}
+
+
+static void csvFieldAsString(const ml_csv_field &field, ml_string &value) {
+  value.assign(field.begin, field.end);
+  if(field.quoted) {
+    std::size_t pos = 0;
+    while((pos = value.find("\"\"", pos)) != ml_string::npos) {
+      value.erase(pos, 1);
+      ++pos;
+    }
+  }
+}
+
+
+//
+// the field references the input text unless it's a quoted field with 
+// escaped quotes, which is unescaped into scratch.
+//
+static ml_string_ref csvFieldAsRef(const ml_csv_field &field, ml_string &scratch) {
+  if(field.quoted && (memchr(field.begin, '"', field.end - field.begin) != nullptr)) {
+    csvFieldAsString(field, scratch);
+    return(ml_string_ref{scratch.data(), scratch.size()});
+  }
+
+  return(ml_string_ref{field.begin, (std::size_t) (field.end - field.begin)});
+}
+
+
+//
+// returns the delimiter (or end of line) after the field starting at field_begin.
+// quotes only delimit a field that starts with a quote, so other fields are 
+// skipped with memchr.
+//
+static const char *findEndOfCSVField(const char *field_begin, const char *end) {
+
+  if((field_begin < end) && (*field_begin == '"')) {
+    bool quoted = false;
+    for(const char *ch = field_begin; ch < end; ++ch) {
+      if(*ch == '"') {
+	quoted = !quoted;
+      }
+      else if((*ch == ML_CSV_DELIM) && !quoted) {
+	return(ch);
+      }
+    }
+    return(end);
+  }
+
+  const char *delim = (const char *) memchr(field_begin, ML_CSV_DELIM, end - field_begin);
+  return(delim ? delim : end);
+}
+
+
+static void tokenizeCSVLine(const char *begin, const char *end, ml_vector<ml_csv_field> &fields) {
+
+  fields.clear();
+
+  const char *field_begin = begin;
+  while(true) {
+    const char *field_end = findEndOfCSVField(field_begin, end);
+    fields.push_back(csvFieldForRange(field_begin, field_end));
+    if(field_end == end) {
+      break;
+    }
+    field_begin = field_end + 1;
+  }
+}
+
+
+//
+// tokenize only the loaded columns of a line (ignored columns are skipped without 
+// being stored or unquoted). first_field is set to the first column whether or 
+// not it's loaded (instance id). returns the number of columns in the line.
+//
+static std::size_t tokenizeCSVLineColumns(const char *begin, const char *end, const ml_vector<bool> &ignored_columns,
+					  ml_vector<ml_csv_field> &fields, ml_csv_field &first_field) {
+
+  fields.clear();
+
+  std::size_t column = 0;
+  const char *field_begin = begin;
+  while(true) {
+    const char *field_end = findEndOfCSVField(field_begin, end);
+    if(column == 0) {
+      first_field = csvFieldForRange(field_begin, field_end);
+    }
+    
+    if((column < ignored_columns.size()) && !ignored_columns[column]) {
+      fields.push_back(csvFieldForRange(field_begin, field_end));
+    }
+
+    ++column;
+    if(field_end == end) {
+      break;
+    }
+    field_begin = field_end + 1;
+  }
+
+  return(column);
+}
+
+
+//
+// returns the end of the line that starts at begin (without the newline or 
+// carriage return) and sets next to the start of the following line
+//
+static const char *findEndOfLine(const char *begin, const char *end, const char *&next) {
+
+  const char *line_end = (const char *) memchr(begin, '\n', end - begin);
+  if(!line_end) {
+    line_end = end;
+    next = end;
+  }
+  else {
+    next = line_end + 1;
+  }
+
+  if((line_end > begin) && (*(line_end - 1) == '\r')) {
+    --line_end;
+  }
+
+  return(line_end);
+}
+
+
+static bool isValueMissing(const ml_string_ref &value) {
+  return((value.size == 0) || 
+	 ((value.size == 1) && (value.data[0] == '?')) || 
+	 ((value.size == 2) && (value.data[0] == 'N') && (value.data[1] == 'A')));
+}
+
+
+static bool isDigitChar(char ch) {
+  return((ch >= '0') && (ch <= '9'));
+}
+
+
+static bool matchesTokenIgnoringCase(const char *begin, const char *end, const char *token) {
+  for(; *token; ++begin, ++token) {
+    if((begin == end) || ((*begin | 0x20) != *token)) {
+      return(false);
+    }
+  }
+  return(true);
+}
+
+
+//
+// locale independent string to float conversion. like stof, leading whitespace 
+// and trailing characters are ignored and false is returned if no number is found.
+// up to 19 significant digits are accumulated in an integer and scaled once by a 
+// power of ten.
+//
+static bool parseFloatValue(const char *begin, const char *end, ml_float &value) {
+
+  static const ml_double exact_powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  const char *ch = begin;
+  while((ch < end) && ((*ch == ' ') || (*ch == '\t'))) {
+    ++ch;
+  }
+
+  bool negative = false;
+  if((ch < end) && ((*ch == '-') || (*ch == '+'))) {
+    negative = (*ch == '-');
+    ++ch;
+  }
+
+  if(matchesTokenIgnoringCase(ch, end, "inf")) {
+    value = negative ? -std::numeric_limits<ml_float>::infinity() : std::numeric_limits<ml_float>::infinity();
+    return(true);
+  }
+
+  if(matchesTokenIgnoringCase(ch, end, "nan")) {
+    value = std::numeric_limits<ml_float>::quiet_NaN();
+    return(true);
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0, exponent = 0;
+  bool found_digit = false;
+
+  for(; (ch < end) && isDigitChar(*ch); ++ch) {
+    found_digit = true;
+    if(digits < 19) {
+      mantissa = (mantissa * 10) + (*ch - '0');
+      digits += (mantissa > 0) ? 1 : 0;
+    }
+    else {
+      ++exponent;
+    }
+  }
+
+  if((ch < end) && (*ch == '.')) {
+    for(++ch; (ch < end) && isDigitChar(*ch); ++ch) {
+      found_digit = true;
+      if(digits < 19) {
+	mantissa = (mantissa * 10) + (*ch - '0');
+	digits += (mantissa > 0) ? 1 : 0;
+	--exponent;
+      }
+    }
+  }
+
+  if(!found_digit) {
+    return(false);
+  }
+
+  if((ch < end) && ((*ch == 'e') || (*ch == 'E'))) {
+    const char *exp_ch = ch + 1;
+    bool exp_negative = false;
+    if((exp_ch < end) && ((*exp_ch == '-') || (*exp_ch == '+'))) {
+      exp_negative = (*exp_ch == '-');
+      ++exp_ch;
+    }
+
+    if((exp_ch < end) && isDigitChar(*exp_ch)) {
+      int exp_value = 0;
+      for(; (exp_ch < end) && isDigitChar(*exp_ch); ++exp_ch) {
+	exp_value = (exp_value < 10000) ? ((exp_value * 10) + (*exp_ch - '0')) : exp_value;
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+    }
+  }
+
+  ml_double result = 0.0;
+  if(mantissa == 0) {
+    result = 0.0;
+  }
+  else if((mantissa < (1ULL << 53)) && (exponent >= -22) && (exponent <= 22)) {
+    // both the mantissa and power of ten are exact, so the result is correctly rounded
+    result = (exponent < 0) ? (mantissa / exact_powers_of_ten[-exponent]) : (mantissa * exact_powers_of_ten[exponent]);
+  }
+  else if(exponent < -(digits + 64)) {
+    result = 0.0;
+  }
+  else if(exponent > 64) {
+    result = std::numeric_limits<ml_double>::infinity();
+  }
+  else {
+    result = (ml_double) (mantissa * powl(10.0L, exponent));
+  }
+
+  value = (ml_float) (negative ? -result : result);
+
+  return(true);
+}
+
+
+//
+// discrete categories found within a chunk. values reference the input text
+// (or unescaped_values) so strings are only created for distinct categories 
+// when the chunk is merged.
+//
+struct ml_load_dictionary {
+  std::unordered_map<ml_string_ref, ml_uint, ml_string_ref_hash> values_map;
+  ml_vector<ml_string_ref> values;
+  ml_vector<ml_uint> values_count;
+  std::deque<ml_string> unescaped_values;
+};
+
+
+static ml_uint findDiscreteValueIndexForValue(const ml_string_ref &value, bool value_is_transient, ml_load_dictionary &dictionary) {
+
+  auto it = dictionary.values_map.find(value);
+  if(it != dictionary.values_map.end()) {
+    return(it->second);
+  }
+
+  ml_string_ref key = value;
+  if(value_is_transient) {
+    dictionary.unescaped_values.push_back(ml_string(value.data, value.size));
+    key = ml_string_ref{dictionary.unescaped_values.back().data(), value.size};
+  }
+
+  ml_uint index = dictionary.values.size();
+  dictionary.values.push_back(key);
+  dictionary.values_count.push_back(0);
+  dictionary.values_map[key] = index;
+
+  return(index);
+}
+
+
+//
+// a range of lines from the input file that is parsed on its own thread. discrete
+// categories, missing counts and stats are local to the chunk until they're merged 
+// in file order.
+//
+struct ml_load_chunk {
+  const char *begin = nullptr;
+  const char *end = nullptr;
+  ml_vector<ml_load_dictionary> dictionaries;
+  ml_vector<ml_uint> missing;
+  ml_vector<ml_stats_helper> stats_helper;
+  ml_data mld;
+  ml_vector<ml_string> ids;
+  ml_uint lines = 0;
+  bool keep_missing = false;
+  std::size_t fill_missing_feature = 0; // with keep_missing, the feature filled in anyway (mlid.size() for none)
+  bool status = true;
+};
+
+
+static void initLoadChunk(const ml_instance_definition &mlid, ml_load_chunk &chunk) {
+  chunk.dictionaries.resize(mlid.size());
+  chunk.missing.resize(mlid.size(), 0);
+  for(std::size_t ii = 0; ii < mlid.size(); ++ii) {
+    ml_stats_helper sh = {};
+    chunk.stats_helper.push_back(sh);
+
+    //
+    // as in ml_feature_desc, local index 0 is the unknown category so that missing 
+    // values (index 0) are merged as unknown and not as the chunk's first category
+    //
+    if(mlid[ii]->type == ml_feature_type::discrete) {
+      ml_string_ref unknown = {ML_UNKNOWN_DISCRETE_CATEGORY.data(), ML_UNKNOWN_DISCRETE_CATEGORY.size()};
+      findDiscreteValueIndexForValue(unknown, false, chunk.dictionaries[ii]);
+    }
+  }
+}
+
+
+static bool processInstanceFeatures(const ml_instance_definition &mlid, ml_load_chunk &chunk, const ml_vector<ml_csv_field> &fields, 
+				    std::size_t column_count, const ml_vector<bool> &ignored_columns, ml_string &scratch) {  
 
-  if(features_as_string.size() != (mlid.size() + ignored_features.size())) {
+  if(column_count != ignored_columns.size()) {
     log_error("feature count mismatch b/t data row (%zu) and instance definition row (%zu); ignored (%zu)\n", 
-		 features_as_string.size(), mlid.size() + ignored_features.size(), ignored_features.size());
+	      column_count, ignored_columns.size(), ignored_columns.size() - mlid.size());
     return(false);
   }    
 
@@ -188,53 +573,177 @@ static bool processInstanceFeatures(ml_instance_definition &mlid, ml_data &mld,
 
   mli->reserve(mlid.size());
 
-  for(std::size_t str_index=0; str_index < features_as_string.size(); ++str_index) {
+  //
+  // fields only holds the loaded columns (see tokenizeCSVLineColumns)
+  //
+  for(std::size_t str_index=0; str_index < fields.size(); ++str_index) {
 
-    if(ignored_features.find(str_index) != ignored_features.end()) {
-      continue;
-    }
+    ml_string_ref value = csvFieldAsRef(fields[str_index], scratch);
 
-    ml_feature_value mlfv;
-    if(isValueMissing(features_as_string[str_index])) {
+    ml_feature_value mlfv = {};
+    if(isValueMissing(value)) {
       //
       // This instance is missing the value for this feature. We record the 
       // instance index so that later we can populate using the mean or mode.
       //
-      stats_helper[feature_index].missing_data_instance_indices.push_back(mld.size());
-      mlid[feature_index]->missing += 1;
+      chunk.missing[feature_index] += 1;
+      if(chunk.keep_missing && (feature_index != chunk.fill_missing_feature)) { // see ml_load_options::keep_missing
+	if(mlid[feature_index]->type == ml_feature_type::continuous) {
+	  mlfv.continuous_value = std::numeric_limits<ml_float>::quiet_NaN();
+	}
+      }
+      else {
+	chunk.stats_helper[feature_index].missing_data_instance_indices.push_back(chunk.mld.size());
+      }
     }
     else if(mlid[feature_index]->type == ml_feature_type::continuous) {
       //
-      // Convert from string and update the online mean/variance calculation.
+      // Convert from text and update the online mean/variance calculation.
       //
-      try {
-	mlfv.continuous_value = stof(features_as_string[str_index]);
-      }
-      catch(...) {
+      if(!parseFloatValue(value.data, value.data + value.size, mlfv.continuous_value)) {
 	puml::log_error("non-numeric value: '%s' given for continuous feature '%s'\n",
-		       features_as_string[str_index].c_str(), mlid[feature_index]->name.c_str());
+			ml_string(value.data, value.size).c_str(), mlid[feature_index]->name.c_str());
 	return(false);
       }
 
-      updateStatsHelperWithFeatureValue(stats_helper[feature_index], mlfv);
+      updateStatsHelperWithFeatureValue(chunk.stats_helper[feature_index], mlfv);
     }
     else { 
       //
-      // ml_feature_type::discrete 
+      // ml_feature_type::discrete (index is local to the chunk until merged)
       //
-      mlfv.discrete_value_index = findDiscreteValueIndexForValue(features_as_string[str_index], *mlid[feature_index]);
-      mlid[feature_index]->discrete_values_count[mlfv.discrete_value_index] += 1;
+      ml_load_dictionary &dictionary = chunk.dictionaries[feature_index];
+      mlfv.discrete_value_index = findDiscreteValueIndexForValue(value, (value.data == scratch.data()), dictionary);
+      dictionary.values_count[mlfv.discrete_value_index] += 1;
     }
 
     mli->push_back(mlfv);
     ++feature_index;
   }
     
-  mld.push_back(mli);
+  chunk.mld.push_back(mli);
 
   return(true);
 }
 
+
+static void parseInstanceChunk(const ml_instance_definition &mlid, ml_load_chunk &chunk, 
+			       const ml_vector<bool> &ignored_columns, bool collect_ids) {
+
+  ml_vector<ml_csv_field> fields;
+  ml_csv_field first_field = {};
+  ml_string scratch;
+
+  const char *next = chunk.begin;
+  while(next < chunk.end) {
+
+    const char *line_begin = next;
+    const char *line_end = findEndOfLine(line_begin, chunk.end, next);
+    ++chunk.lines;
+
+    std::size_t column_count = tokenizeCSVLineColumns(line_begin, line_end, ignored_columns, fields, first_field);
+    if(column_count == 1) { // empty line
+      continue;
+    }
+
+    if(!processInstanceFeatures(mlid, chunk, fields, column_count, ignored_columns, scratch)) {
+      chunk.status = false;
+      return;
+    }
+
+    // 
+    // we store the first column (assumed to be the instance id) if requested
+    //
+    if(collect_ids) {
+      chunk.ids.push_back(ml_string());
+      csvFieldAsString(first_field, chunk.ids.back());
+    }
+  }
+
+}
+
+
+static void mergeStatsHelper(ml_stats_helper &stats_helper, const ml_stats_helper &chunk_stats_helper, ml_uint instance_offset) {
+
+  //
+  // combine the online mean/variance of the chunk (parallel variant of welford)
+  //
+  if(stats_helper.count == 0) {
+    stats_helper.count = chunk_stats_helper.count;
+    stats_helper.mean = chunk_stats_helper.mean;
+    stats_helper.M2 = chunk_stats_helper.M2;
+  }
+  else if(chunk_stats_helper.count > 0) {
+    ml_double count = (ml_double) stats_helper.count + chunk_stats_helper.count;
+    ml_double delta = chunk_stats_helper.mean - stats_helper.mean;
+    stats_helper.mean += delta * (chunk_stats_helper.count / count);
+    stats_helper.M2 += chunk_stats_helper.M2 + (delta * delta * ((ml_double) stats_helper.count * chunk_stats_helper.count / count));
+    stats_helper.count += chunk_stats_helper.count;
+  }
+
+  for(const auto &instance_index : chunk_stats_helper.missing_data_instance_indices) {
+    stats_helper.missing_data_instance_indices.push_back(instance_index + instance_offset);
+  }
+}
+
+
+static void mergeLoadChunk(ml_instance_definition &mlid, ml_data &mld, ml_vector<ml_stats_helper> &stats_helper, 
+			   ml_load_chunk &chunk, ml_vector<ml_string> *ids, bool count_values) {
+
+  ml_uint instance_offset = mld.size();
+
+  //
+  // map the chunk's discrete categories to the global categories. new 
+  // categories are added in the order they were found in the chunk.
+  //
+  ml_vector<ml_vector<ml_uint>> discrete_index_remap(mlid.size());
+  ml_vector<ml_uint> discrete_features;
+  for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
+
+    if(count_values) {
+      mlid[findex]->missing += chunk.missing[findex];
+    }
+    mergeStatsHelper(stats_helper[findex], chunk.stats_helper[findex], instance_offset);
+
+    if(mlid[findex]->type != ml_feature_type::discrete) {
+      continue;
+    }
+
+    const ml_load_dictionary &dictionary = chunk.dictionaries[findex];
+    ml_vector<ml_uint> &remap = discrete_index_remap[findex];
+    for(std::size_t jj = 0; jj < dictionary.values.size(); ++jj) {
+      ml_string value(dictionary.values[jj].data, dictionary.values[jj].size);
+      ml_uint index = findDiscreteValueIndexForValue(value, *mlid[findex]);
+      if(count_values) {
+	mlid[findex]->discrete_values_count[index] += dictionary.values_count[jj];
+      }
+      remap.push_back(index);
+    }
+
+    discrete_features.push_back(findex);
+  }
+
+  for(auto &inst_ptr : chunk.mld) {
+    ml_instance &instance = *inst_ptr;
+    for(const auto &findex : discrete_features) {
+      const ml_vector<ml_uint> &remap = discrete_index_remap[findex];
+      if(instance[findex].discrete_value_index < remap.size()) {
+	instance[findex].discrete_value_index = remap[instance[findex].discrete_value_index];
+      }
+    }
+
+    mld.push_back(inst_ptr);
+  }
+
+  if(ids) {
+    ids->insert(ids->end(), chunk.ids.begin(), chunk.ids.end());
+  }
+
+  chunk.mld.clear();
+  chunk.ids.clear();
+}
+
+
 static void findModeValueIndexForDiscreteFeature(ml_feature_desc &mlfd) {
   
   if(mlfd.type != ml_feature_type::discrete) {
@@ -321,365 +830,1762 @@ static bool instanceDefinitionsMatchInCountTypeAndName(const ml_instance_definit
   return(instanceDefinitionsMatch(mlid, mlid_temp, false));
 }
 
-static bool loadInstanceDataFromFile(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld, ml_vector<ml_string> *ids) {
+static bool readFileIntoBuffer(const ml_string &path_to_input_file, ml_string &buffer) {
 
-  mld.clear();
-  bool mlid_preloaded = mlid.empty() ? false : true;
+  std::ifstream input(path_to_input_file, std::ios::in | std::ios::binary);
+  if(!input) {
+    return(false);
+  }
 
-  rapidcsv::Document doc(path_to_input_file, rapidcsv::LabelParams(-1, -1)); 
-  int row_count = doc.GetRowCount();
-  if(row_count <= 0) {
-    log_error("can't open input file %s\n", path_to_input_file.c_str());
+  input.seekg(0, std::ios::end);
+  std::streamoff size = input.tellg();
+  input.seekg(0, std::ios::beg);
+  if(size <= 0) {
     return(false);
   }
 
-  ml_vector<ml_stats_helper> stats_helper;
-  ml_map<ml_uint, bool> ignored_features;
+  buffer.resize(size);
+  input.read(&buffer[0], size);
 
-  for(int row_idx = 0; row_idx < row_count; ++row_idx) {
+  return(input.gcount() == size);
+}
 
-    ml_vector<ml_string> features_as_string = doc.GetRow<ml_string>(row_idx);
-    if(features_as_string.empty() || (features_as_string.size() == 1)) { // empty line
-      continue;
-    }
 
-    if(stats_helper.size() == 0) {
-      //
-      // The first line defines each feature. For example, Feature1:C,Feature2:C,Feature3:D,Feature4:I,... 
-      // defines Feature1 and Feature2 as a continuous features, Feature3 as discrete, and Feature4 is ignored. 
-      //
-      ml_instance_definition mlid_temp;
-      if(!initInstanceDefinition(mlid_temp, features_as_string, stats_helper, ignored_features)) {
-	log_error("confused by instance definition line:%d\n", row_idx);
-	return(false);
-      }
+static ml_uint numberOfLoadThreads(const ml_load_options &options) {
+  ml_uint threads = (options.number_of_threads > 0) ? options.number_of_threads : std::thread::hardware_concurrency();
+  return((threads > 0) ? threads : 1);
+}
 
-      if(!mlid_preloaded) {
-	mlid = mlid_temp;
-      }
-      else if(!instanceDefinitionsMatchInCountTypeAndName(mlid, mlid_temp)) {
-	log_error("file format doesn't match preloaded instance definition\n");
-	return(false);
-      }
 
-    }
-    else {
-      //
-      // Update stats for each feature, add the instance to ml_data, etc
-      //
-      if(!processInstanceFeatures(mlid, mld, features_as_string, stats_helper, ignored_features)) {
-	log_error("confused by instance row:%d\n", row_idx);
-	return(false);
-      }
+//
+// The first line defines each feature. For example, Feature1:C,Feature2:C,Feature3:D,Feature4:I,... 
+// defines Feature1 and Feature2 as a continuous features, Feature3 as discrete, and Feature4 is ignored. 
+// ignored_columns is set with an entry per column of the line. When columns (names) are given, 
+// every other column is ignored too.
+//
+static bool parseInstanceDefinitionFields(const ml_vector<ml_csv_field> &fields, const ml_vector<ml_string> &columns,
+					  ml_instance_definition &mlid, ml_vector<bool> &ignored_columns) {
 
-      // 
-      // we store the first column (assumed to be the instance id) if a vector is given
-      //
-      if(ids) {
-	ids->push_back(features_as_string[0]);
+  ml_vector<ml_string> features_as_string(fields.size());
+  for(std::size_t ii = 0; ii < fields.size(); ++ii) {
+    csvFieldAsString(fields[ii], features_as_string[ii]);
+  }
+
+  if(!columns.empty()) {
+    ml_set<ml_string> columns_to_load(columns.begin(), columns.end());
+    for(auto &feature_as_string : features_as_string) {
+      ml_string name = feature_as_string.substr(0, feature_as_string.find(':'));
+      name = stringTrimLeadingTrailingWhitespace(name);
+      if(columns_to_load.erase(name) == 0) {
+	feature_as_string = name + ":I";
       }
     }
 
-  }
-  
-  
-  if(!mlid_preloaded) {
-    calcMeanOrModeOfFeatures(mlid, mld, stats_helper);
+    if(!columns_to_load.empty()) {
+      log_error("column '%s' isn't in the instance definition line\n", columns_to_load.begin()->c_str());
+      return(false);
+    }
   }
 
-  fillMissingInstanceFeatureValues(mlid, mld, stats_helper);
+  ml_vector<ml_stats_helper> stats_helper;
+  ml_map<ml_uint, bool> ignored_features;
+  if(!initInstanceDefinition(mlid, features_as_string, stats_helper, ignored_features)) {
+    return(false);
+  }
+
+  ignored_columns.assign(fields.size(), false);
+  for(const auto &ignored : ignored_features) {
+    ignored_columns[ignored.first] = true;
+  }
+
+  return(true);
+}
+
+
+//
+// parse the instance lines in [begin, end) and append the instances to mld. The lines
+// are split into chunks (on line boundaries) that are parsed in parallel and then merged
+// in file order. first_line is the line number of begin (for error reporting).
+//
+static bool parseInstanceLines(const char *begin, const char *end, ml_uint first_line, const ml_load_options &options,
+			       ml_instance_definition &mlid, const ml_vector<bool> &ignored_columns, 
+			       ml_data &mld, ml_vector<ml_stats_helper> &stats_helper, ml_vector<ml_string> *ids,
+			       bool count_values = true) {
+
+  ml_uint threads = numberOfLoadThreads(options);
+  std::size_t lines_size = end - begin;
+  std::size_t chunk_count = std::min<std::size_t>(threads, lines_size / ML_LOAD_MIN_CHUNK_BYTES);
+  chunk_count = (chunk_count > 0) ? chunk_count : 1;
+
+  std::size_t fill_missing_feature = mlid.size();
+  for(std::size_t ii = 0; ii < mlid.size(); ++ii) {
+    if(options.keep_missing && (mlid[ii]->name == options.feature_to_predict)) {
+      fill_missing_feature = ii;
+    }
+  }
+
+  ml_vector<ml_load_chunk> chunks(chunk_count);
+  for(std::size_t ii = 0; ii < chunk_count; ++ii) {
+    ml_load_chunk &chunk = chunks[ii];
+    initLoadChunk(mlid, chunk);
+    chunk.keep_missing = options.keep_missing;
+    chunk.fill_missing_feature = fill_missing_feature;
+
+    chunk.begin = (ii == 0) ? begin : chunks[ii-1].end;
+    chunk.end = (ii == (chunk_count - 1)) ? end : std::max(chunk.begin, begin + (lines_size * (ii + 1)) / chunk_count);
+    if(chunk.end < end) {
+      findEndOfLine(chunk.end, end, chunk.end);
+    }
+  }
+
+  ml_vector<std::thread> work_threads;
+  for(std::size_t ii = 1; ii < chunk_count; ++ii) {
+    ml_load_chunk *chunk = &chunks[ii];
+    work_threads.emplace_back(std::thread([chunk, &mlid, &ignored_columns, ids] { parseInstanceChunk(mlid, *chunk, ignored_columns, ids != nullptr); }));
+  }
+
+  parseInstanceChunk(mlid, chunks[0], ignored_columns, ids != nullptr);
+
+  for(auto &thread : work_threads) {
+    thread.join();
+  }
+
+  //
+  // combine instances, discrete categories and stats from each chunk (in file order)
+  //
+  ml_uint lines = first_line;
+  for(auto &chunk : chunks) {
+    if(!chunk.status) {
+      log_error("confused by instance row:%d\n", lines + chunk.lines - 1);
+      return(false);
+    }
+
+    lines += chunk.lines;
+    mergeLoadChunk(mlid, mld, stats_helper, chunk, ids, count_values);
+  }
+
+  return(true);
+}
+
+
+//
+// reads the lines of a plain or compressed (see ml_file_reader) text file a block at a 
+// time. the text returned by next_line()/next_lines() is valid until the next call.
+//
+class ml_line_reader final {
+ public:
+  bool open(const ml_string &path) { reset(0); return(input_.open(path)); }
+  bool seek(uint64_t offset) { reset(offset); return(input_.seek(offset)); }
+
+  bool next_line(const char *&begin, const char *&end);
+  bool next_lines(ml_uint max_lines, std::size_t max_bytes, const char *&begin, const char *&end, ml_uint &lines);
+
+  // offset (in the decompressed text) of the next line
+  uint64_t position() const { return(buffer_offset_ + buffer_pos_); }
+
+  ml_file_reader &input() { return(input_); }
+
+ private:
+  void reset(uint64_t offset);
+  bool fill();
+  void compact();
+
+  ml_file_reader input_;
+  ml_string buffer_;
+  std::size_t buffer_pos_ = 0;
+  uint64_t buffer_offset_ = 0;
+  bool eof_ = false;
+};
+
+
+void ml_line_reader::reset(uint64_t offset) {
+  buffer_.clear();
+  buffer_pos_ = 0;
+  buffer_offset_ = offset;
+  eof_ = false;
+}
+
+
+bool ml_line_reader::fill() {
+
+  if(eof_) {
+    return(false);
+  }
+
+  std::size_t size = buffer_.size();
+  buffer_.resize(size + ML_LOAD_MIN_CHUNK_BYTES);
+
+  std::size_t bytes_read = input_.read(&buffer_[size], ML_LOAD_MIN_CHUNK_BYTES);
+  buffer_.resize(size + bytes_read);
+  if(bytes_read < ML_LOAD_MIN_CHUNK_BYTES) {
+    eof_ = true;
+  }
+
+  return(bytes_read > 0);
+}
+
+
+void ml_line_reader::compact() {
+  buffer_.erase(0, buffer_pos_);
+  buffer_offset_ += buffer_pos_;
+  buffer_pos_ = 0;
+}
+
+
+bool ml_line_reader::next_line(const char *&begin, const char *&end) {
+  ml_uint lines = 0;
+  if(!next_lines(1, std::numeric_limits<std::size_t>::max(), begin, end, lines)) {
+    return(false);
+  }
+
+  const char *next = nullptr;
+  end = findEndOfLine(begin, end, next);
+  return(true);
+}
+
+
+bool ml_line_reader::next_lines(ml_uint max_lines, std::size_t max_bytes, const char *&begin, const char *&end, ml_uint &lines) {
+
+  //
+  // the lines are kept in the buffer since they're parsed in place
+  //
+  compact();
+
+  std::size_t scanned = 0;
+  lines = 0;
+  while((lines < max_lines) && (scanned < max_bytes)) {
+    const char *newline = (const char *) memchr(buffer_.data() + scanned, '\n', buffer_.size() - scanned);
+    if(newline) {
+      scanned = (newline - buffer_.data()) + 1;
+      ++lines;
+    }
+    else if(!fill()) {
+      if(scanned < buffer_.size()) { // last line without a newline
+	scanned = buffer_.size();
+	++lines;
+      }
+      break;
+    }
+  }
+
+  buffer_pos_ = scanned;
+  begin = buffer_.data();
+  end = begin + scanned;
+
+  return(scanned > 0);
+}
+
+
+//
+// read up to (and including) the instance definition line. line_number is the number of lines read.
+//
+static bool readInstanceDefinitionLine(ml_line_reader &lines, const ml_string &path_to_input_file, const ml_vector<ml_string> &columns,
+				       ml_instance_definition &mlid, ml_vector<bool> &ignored_columns, ml_uint &line_number) {
+
+  ignored_columns.clear();
+  line_number = 0;
+
+  const char *line_begin = nullptr, *line_end = nullptr;
+  while(lines.next_line(line_begin, line_end)) {
+    if((line_number++ == 0) && ((line_end - line_begin) >= 3) && (memcmp(line_begin, "\xef\xbb\xbf", 3) == 0)) { // utf-8 byte order mark
+      line_begin += 3;
+    }
+
+    ml_vector<ml_csv_field> fields;
+    tokenizeCSVLine(line_begin, line_end, fields);
+    if(fields.size() == 1) { // empty line
+      continue;
+    }
+
+    if(!parseInstanceDefinitionFields(fields, columns, mlid, ignored_columns)) {
+      log_error("confused by instance definition line:%d\n", line_number - 1);
+      return(false);
+    }
+
+    return(true);
+  }
+
+  log_error("missing instance definition line in %s\n", path_to_input_file.c_str());
+  return(false);
+}
+
+
+//
+// compressed files are parsed in batches of lines while the following blocks are decompressed
+//
+static bool loadInstanceDataFromCompressedFile(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld, 
+					       ml_vector<ml_string> *ids, const ml_load_options &options) {
+
+  mld.clear();
+  bool mlid_preloaded = mlid.empty() ? false : true;
+
+  ml_line_reader lines;
+  if(!lines.open(path_to_input_file)) {
+    log_error("can't open input file %s\n", path_to_input_file.c_str());
+    return(false);
+  }
+
+  ml_instance_definition mlid_temp;
+  ml_vector<bool> ignored_columns;
+  ml_uint line_number = 0;
+  if(!readInstanceDefinitionLine(lines, path_to_input_file, options.columns, mlid_temp, ignored_columns, line_number)) {
+    return(false);
+  }
+
+  if(!mlid_preloaded) {
+    mlid = mlid_temp;
+  }
+  else if(!instanceDefinitionsMatchInCountTypeAndName(mlid, mlid_temp)) {
+    log_error("file format doesn't match preloaded instance definition\n");
+    return(false);
+  }
+
+  ml_uint threads = numberOfLoadThreads(options);
+  ml_vector<ml_stats_helper> stats_helper(mlid.size(), ml_stats_helper());
+
+  const char *begin = nullptr, *end = nullptr;
+  ml_uint batch_lines = 0;
+  while(lines.next_lines(std::numeric_limits<ml_uint>::max(), threads * ML_LOAD_BATCH_BYTES, begin, end, batch_lines)) {
+    if(!parseInstanceLines(begin, end, line_number, options, mlid, ignored_columns, mld, stats_helper, ids)) {
+      mld.clear();
+      return(false);
+    }
+    line_number += batch_lines;
+  }
+
+  if(lines.input().failed()) {
+    mld.clear();
+    return(false);
+  }
+
+  if(!mlid_preloaded) {
+    calcMeanOrModeOfFeatures(mlid, mld, stats_helper);
+  }
+
+  fillMissingInstanceFeatureValues(mlid, mld, stats_helper);
+
+  return(true);
+}
+
+
+static bool loadInstanceDataFromFile(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld, 
+				     ml_vector<ml_string> *ids, const ml_load_options &options) {
+
+  if(ml_file_reader::is_compressed(path_to_input_file)) {
+    return(loadInstanceDataFromCompressedFile(path_to_input_file, mlid, mld, ids, options));
+  }
+
+  mld.clear();
+  bool mlid_preloaded = mlid.empty() ? false : true;
+
+  //
+  // the file is memory mapped (or read into a buffer) and fields are parsed in place
+  //
+  ml_mapped_file mapped_file;
+  ml_string buffer;
+  const char *data_begin = nullptr;
+  std::size_t data_size = 0;
+
+  if(options.memory_map && mapped_file.open(path_to_input_file)) {
+    data_begin = mapped_file.data();
+    data_size = mapped_file.size();
+  }
+  else if(readFileIntoBuffer(path_to_input_file, buffer)) {
+    data_begin = buffer.data();
+    data_size = buffer.size();
+  }
+  else {
+    log_error("can't open input file %s\n", path_to_input_file.c_str());
+    return(false);
+  }
+
+  const char *data_end = data_begin + data_size;
+  if((data_size >= 3) && (memcmp(data_begin, "\xef\xbb\xbf", 3) == 0)) { // utf-8 byte order mark
+    data_begin += 3;
+  }
+
+  ml_vector<bool> ignored_columns;
+  ml_uint header_lines = 0;
+
+  const char *next = data_begin;
+  while(next < data_end) {
+
+    const char *line_begin = next;
+    const char *line_end = findEndOfLine(line_begin, data_end, next);
+    ++header_lines;
+
+    ml_vector<ml_csv_field> fields;
+    tokenizeCSVLine(line_begin, line_end, fields);
+    if(fields.size() == 1) { // empty line
+      continue;
+    }
+
+    ml_instance_definition mlid_temp;
+    if(!parseInstanceDefinitionFields(fields, options.columns, mlid_temp, ignored_columns)) {
+      log_error("confused by instance definition line:%d\n", header_lines - 1);
+      return(false);
+    }
+
+    if(!mlid_preloaded) {
+      mlid = mlid_temp;
+    }
+    else if(!instanceDefinitionsMatchInCountTypeAndName(mlid, mlid_temp)) {
+      log_error("file format doesn't match preloaded instance definition\n");
+      return(false);
+    }
+
+    break;
+  }
+
+  if(ignored_columns.empty()) {
+    log_error("missing instance definition line in %s\n", path_to_input_file.c_str());
+    return(false);
+  }
+
+  ml_vector<ml_stats_helper> stats_helper(mlid.size(), ml_stats_helper());
+  if(!parseInstanceLines(next, data_end, header_lines, options, mlid, ignored_columns, mld, stats_helper, ids)) {
+    mld.clear();
+    return(false);
+  }
+  
+  if(!mlid_preloaded) {
+    calcMeanOrModeOfFeatures(mlid, mld, stats_helper);
+  }
+
+  fillMissingInstanceFeatureValues(mlid, mld, stats_helper);
+
+  return(true);
+}
+
+bool load_data_using_instance_definition(const ml_string &path_to_input_file, 
+					 const ml_instance_definition &mlid, 
+					 ml_data &mld, ml_vector<ml_string> *ids,
+					 const ml_load_options &options) {
+
+  ml_instance_definition temp_mlid(mlid);
+  if(!loadInstanceDataFromFile(path_to_input_file, temp_mlid, mld, ids, options)) {
+    return(false);
+  }
+
+  if(!instanceDefinitionsMatch(mlid, temp_mlid, true)) {
+    mld.clear();
+    log_error("file format doesn't match preloaded instance definition...\n");
+  }
+
+  return(true);
+}
+
+static bool loadDataWithBinaryCache(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld,
+				    const ml_load_options &options);
+
+bool load_data(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld,
+	       const ml_load_options &options) {
+  if(options.use_binary_cache) {
+    return(loadDataWithBinaryCache(path_to_input_file, mlid, mld, options));
+  }
+
+  mlid.clear();
+  return(loadInstanceDataFromFile(path_to_input_file, mlid, mld, nullptr, options));
+}
+
+void ml_sparse_data::clear() {
+  row_offsets.assign(1, 0);
+  feature_indices.clear();
+  values.clear();
+}
+
+
+void ml_sparse_data::add_instance(ml_vector<std::pair<ml_uint, ml_feature_value>> &entries) {
+
+  std::stable_sort(entries.begin(), entries.end(), 
+		   [](const std::pair<ml_uint, ml_feature_value> &e1, const std::pair<ml_uint, ml_feature_value> &e2) {
+		     return(e1.first < e2.first);
+		   });
+
+  std::size_t row_begin = feature_indices.size();
+  for(const auto &entry : entries) {
+    //
+    // all bits clear is 0.0 for continuous values and index 0 for discrete values
+    //
+    if(entry.second.discrete_value_index == 0) {
+      continue;
+    }
+
+    if((feature_indices.size() > row_begin) && (feature_indices.back() == entry.first)) { // last value wins
+      values.back() = entry.second;
+      continue;
+    }
+
+    feature_indices.push_back(entry.first);
+    values.push_back(entry.second);
+  }
+
+  row_offsets.push_back(feature_indices.size());
+}
+
+
+ml_feature_value ml_sparse_data::value(std::size_t row, ml_uint feature_index) const {
+
+  auto begin = feature_indices.begin() + row_offsets[row];
+  auto end = feature_indices.begin() + row_offsets[row + 1];
+  auto it = std::lower_bound(begin, end, feature_index);
+  if((it != end) && (*it == feature_index)) {
+    return(values[it - feature_indices.begin()]);
+  }
+
+  ml_feature_value zero = {};
+  return(zero);
+}
+
+
+ml_instance ml_sparse_data::instance(std::size_t row, std::size_t feature_count) const {
+
+  ml_instance instance(feature_count);
+  for(std::size_t ii = row_offsets[row]; ii < row_offsets[row + 1]; ++ii) {
+    if(feature_indices[ii] < feature_count) {
+      instance[feature_indices[ii]] = values[ii];
+    }
+  }
+
+  return(instance);
+}
+
+
+const ml_uint ML_DEFAULT_MAX_BINS = 255;
+
+
+ml_uint ml_prepared_data::codes(ml_uint feature_index) const {
+  if(mlid[feature_index]->type == ml_feature_type::discrete) {
+    return(mlid[feature_index]->discrete_values.size());
+  }
+  return(missing_code(feature_index) + 1);
+}
+
+
+//
+// bin edges of a continuous feature from its sorted (non-missing) values: every
+// distinct value gets its own bin when they fit, otherwise the edges are quantiles
+// (the edges are values of the feature, so the bin of a value never depends on 
+// rounding)
+//
+static void bin_edges_for_sorted_values(const ml_vector<ml_float> &values, ml_uint max_bins, ml_vector<ml_float> &edges) {
+
+  edges.clear();
+  if(values.empty()) {
+    return;
+  }
+
+  ml_uint distinct = 1;
+  for(std::size_t ii = 1; ii < values.size(); ++ii) {
+    distinct += (values[ii] != values[ii-1]) ? 1 : 0;
+  }
+
+  if(distinct <= max_bins) {
+    for(std::size_t ii = 1; ii < values.size(); ++ii) {
+      if(values[ii] != values[ii-1]) {
+	edges.push_back(values[ii]);
+      }
+    }
+    return;
+  }
+
+  for(ml_uint bin = 1; bin < max_bins; ++bin) {
+    ml_float edge = values[(bin * (uint64_t) values.size()) / max_bins];
+    if((edge > values[0]) && (edges.empty() || (edge > edges.back()))) {
+      edges.push_back(edge);
+    }
+  }
+}
+
+
+bool prepare_data(const ml_instance_definition &mlid, const ml_data &mld, 
+		  ml_prepared_data &mlpd, ml_uint max_bins) {
+
+  mlpd = ml_prepared_data{};
+
+  if(mlid.empty() || mld.empty() || (max_bins < 2) || (max_bins > std::numeric_limits<uint16_t>::max() - 1)) {
+    log_error("prepare_data() needs data and 2 to %u bins\n", std::numeric_limits<uint16_t>::max() - 1);
+    return(false);
+  }
+
+  for(const auto &inst_ptr : mld) {
+    if(inst_ptr->size() < mlid.size()) {
+      log_error("feature count mismatch b/t instance definition and instance data\n");
+      return(false);
+    }
+  }
+
+  mlpd.mlid = mlid;
+  mlpd.mld = mld;
+  mlpd.bin_edges.resize(mlid.size());
+  mlpd.columns.resize(mlid.size());
+
+  ml_vector<ml_float> values;
+  for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
+
+    ml_vector<uint16_t> &column = mlpd.columns[findex];
+    column.resize(mld.size());
+
+    if(mlid[findex]->type == ml_feature_type::discrete) {
+      if(mlid[findex]->discrete_values.size() > ((std::size_t) std::numeric_limits<uint16_t>::max() + 1)) {
+	log_error("too many categories to prepare feature %s\n", mlid[findex]->name.c_str());
+	mlpd = ml_prepared_data{};
+	return(false);
+      }
+
+      for(std::size_t row = 0; row < mld.size(); ++row) {
+	column[row] = (*mld[row])[findex].discrete_value_index;
+      }
+      continue;
+    }
+
+    values.clear();
+    for(const auto &inst_ptr : mld) {
+      ml_float value = (*inst_ptr)[findex].continuous_value;
+      if(!std::isnan(value)) {
+	values.push_back(value);
+      }
+    }
+    std::sort(values.begin(), values.end());
+
+    const ml_vector<ml_float> &edges = mlpd.bin_edges[findex];
+    bin_edges_for_sorted_values(values, max_bins, mlpd.bin_edges[findex]);
+
+    uint16_t missing = mlpd.missing_code(findex);
+    for(std::size_t row = 0; row < mld.size(); ++row) {
+      ml_float value = (*mld[row])[findex].continuous_value;
+      column[row] = std::isnan(value) ? missing : (std::upper_bound(edges.begin(), edges.end(), value) - edges.begin());
+    }
+  }
+
+  return(true);
+}
+
+
+static const char *findEndOfLibSVMToken(const char *begin, const char *end) {
+  while((begin < end) && (*begin != ' ') && (*begin != '\t')) {
+    ++begin;
+  }
+  return(begin);
+}
+
+
+static const char *skipLibSVMWhitespace(const char *begin, const char *end) {
+  while((begin < end) && ((*begin == ' ') || (*begin == '\t'))) {
+    ++begin;
+  }
+  return(begin);
+}
+
+
+static bool parseLibSVMLine(const char *begin, const char *end, bool mlid_preloaded, ml_instance_definition &mlid, 
+			    ml_vector<ml_stats_helper> &stats_helper, ml_vector<std::pair<ml_uint, ml_feature_value>> &entries) {
+
+  entries.clear();
+
+  const char *token = skipLibSVMWhitespace(begin, end);
+  const char *token_end = findEndOfLibSVMToken(token, end);
+
+  ml_feature_value label = {};
+  if(mlid[0]->type == ml_feature_type::continuous) {
+    if(!parseFloatValue(token, token_end, label.continuous_value)) {
+      log_error("non-numeric label: '%s'\n", ml_string(token, token_end).c_str());
+      return(false);
+    }
+  }
+  else {
+    label.discrete_value_index = findDiscreteValueIndexForValue(ml_string(token, token_end), *mlid[0]);
+    mlid[0]->discrete_values_count[label.discrete_value_index] += 1;
+  }
+  entries.push_back(std::make_pair(0, label));
+
+  for(token = skipLibSVMWhitespace(token_end, end); token < end; token = skipLibSVMWhitespace(token_end, end)) {
+    
+    token_end = findEndOfLibSVMToken(token, end);
+    const char *separator = (const char *) memchr(token, ':', token_end - token);
+    if(!separator || (separator == token)) {
+      log_error("expected <index>:<value>, got '%s'\n", ml_string(token, token_end).c_str());
+      return(false);
+    }
+
+    if(matchesTokenIgnoringCase(token, separator, "qid")) {
+      continue;
+    }
+
+    ml_uint feature_index = 0;
+    for(const char *ch = token; ch < separator; ++ch) {
+      if(!isDigitChar(*ch) || (feature_index > ((std::numeric_limits<ml_uint>::max() - 9) / 10))) {
+	feature_index = 0;
+	break;
+      }
+      feature_index = (feature_index * 10) + (*ch - '0');
+    }
+
+    ml_feature_value mlfv = {};
+    if((feature_index == 0) || !parseFloatValue(separator + 1, token_end, mlfv.continuous_value)) {
+      log_error("invalid feature '%s' (indices start at 1)\n", ml_string(token, token_end).c_str());
+      return(false);
+    }
+
+    if(feature_index >= mlid.size()) {
+      if(mlid_preloaded) {
+	continue;
+      }
+
+      while(mlid.size() <= feature_index) {
+	ml_feature_desc_ptr mlfd = std::make_shared<ml_feature_desc>();
+	mlfd->name = std::to_string(mlid.size());
+	mlfd->type = ml_feature_type::continuous;
+	mlid.push_back(mlfd);
+	stats_helper.push_back(ml_stats_helper());
+      }
+    }
+
+    if(mlid[feature_index]->type != ml_feature_type::continuous) {
+      log_error("feature %u isn't continuous\n", feature_index);
+      return(false);
+    }
+
+    entries.push_back(std::make_pair(feature_index, mlfv));
+  }
+
+  //
+  // the running stats only see the non-zero values, zeros are added in at the end
+  //
+  for(const auto &entry : entries) {
+    if((mlid[entry.first]->type == ml_feature_type::continuous) && (entry.second.discrete_value_index != 0)) {
+      updateStatsHelperWithFeatureValue(stats_helper[entry.first], entry.second);
+    }
+  }
+
+  return(true);
+}
+
+
+bool load_libsvm_data(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_sparse_data &mlsd,
+		      ml_feature_type label_type) {
+
+  mlsd.clear();
+  bool mlid_preloaded = mlid.empty() ? false : true;
+
+  if(!mlid_preloaded) {
+    ml_feature_desc_ptr mlfd = std::make_shared<ml_feature_desc>();
+    mlfd->name = "label";
+    mlfd->type = label_type;
+    mlid.push_back(mlfd);
+  }
+  else if(mlid[0]->type != label_type) {
+    log_error("label type doesn't match preloaded instance definition\n");
+    return(false);
+  }
+
+  ml_line_reader lines;
+  if(!lines.open(path_to_input_file)) {
+    log_error("can't open input file %s\n", path_to_input_file.c_str());
+    return(false);
+  }
+
+  ml_vector<ml_stats_helper> stats_helper(mlid.size(), ml_stats_helper());
+  ml_vector<std::pair<ml_uint, ml_feature_value>> entries;
+  ml_uint line_number = 0;
+
+  const char *begin = nullptr, *end = nullptr;
+  ml_uint batch_lines = 0;
+  while(lines.next_lines(std::numeric_limits<ml_uint>::max(), ML_LOAD_BATCH_BYTES, begin, end, batch_lines)) {
+
+    const char *next = begin;
+    while(next < end) {
+      const char *line_begin = next;
+      const char *line_end = findEndOfLine(line_begin, end, next);
+      ++line_number;
+
+      line_end = std::find(line_begin, line_end, '#'); // comments run to the end of the line
+      if(skipLibSVMWhitespace(line_begin, line_end) == line_end) { // empty line
+	continue;
+      }
+
+      if(!parseLibSVMLine(line_begin, line_end, mlid_preloaded, mlid, stats_helper, entries)) {
+	log_error("confused by libsvm line:%d\n", line_number);
+	mlsd.clear();
+	return(false);
+      }
+
+      mlsd.add_instance(entries);
+    }
+  }
+
+  if(lines.input().failed()) {
+    mlsd.clear();
+    return(false);
+  }
+
+  if(!mlid_preloaded) {
+    for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
+      if(mlid[findex]->type == ml_feature_type::continuous) {
+	ml_stats_helper zeros = {};
+	zeros.count = mlsd.size() - stats_helper[findex].count;
+	mergeStatsHelper(stats_helper[findex], zeros, 0);
+      }
+    }
+
+    ml_data mld;
+    calcMeanOrModeOfFeatures(mlid, mld, stats_helper);
+  }
+
+  return(true);
+}
+
+
+void print_data_summary(const ml_instance_definition &mlid) {
+
+  log("\n\n*** Data Summary ***\n\n");
+
+  for(std::size_t ii = 0; ii < mlid.size(); ++ii) {
+    log("feature %zu: %s, missing: %d\n", ii, mlid[ii]->name.c_str(), mlid[ii]->missing);
+    if(mlid[ii]->type == ml_feature_type::continuous) {
+      log("     mean: %.3f  std: %.3f\n\n", mlid[ii]->mean, mlid[ii]->sd);
+    }
+    else {
+      const ml_feature_desc &mlfd = *mlid[ii];
+      for(std::size_t jj=1; jj < mlfd.discrete_values.size(); ++jj) {
+	log("  category %zu: %s, count: %d\n", jj, mlfd.discrete_values[jj].c_str(), mlfd.discrete_values_count[jj]);
+      }
+      log("\n");
+    }
+  }
+
+}
+
+
+void split_data_into_training_and_test(ml_data &mld, ml_float training_factor, 
+				       ml_data &training, ml_data &test,
+				       ml_uint seed) {
+  
+  training.clear();
+  test.clear();
+
+  if(mld.empty()) {
+    return;
+  }
+ 
+  if(training_factor > 0.99) {
+    log_error("bogus training factor %.2f\n", training_factor);
+    return;
+  }
+
+  ml_rng rng(seed);
+  shuffle_vector(mld, rng);
+  ml_uint training_size = (ml_uint) ((training_factor * mld.size()) + 0.5);
+  training = ml_data(mld.begin(), mld.begin() + training_size);
+  mld.erase(mld.begin(), mld.begin() + training_size);
+  test = ml_data(mld.begin(), mld.end());
+}
+
+
+void split_data_into_training_and_test(const ml_data &mld, ml_float training_factor, 
+				       ml_data_view &training, ml_data_view &test,
+				       ml_uint seed) {
+  
+  training = test = ml_data_view();
+
+  if(mld.empty()) {
+    return;
+  }
+ 
+  if(training_factor > 0.99) {
+    log_error("bogus training factor %.2f\n", training_factor);
+    return;
+  }
+
+  ml_rng rng(seed);
+  auto order = shuffled_rows(mld.size(), rng);
+  std::size_t training_size = (ml_uint) ((training_factor * mld.size()) + 0.5);
+  training = ml_data_view(mld, order, {ml_data_view::ml_row_range(0, training_size)});
+  test = ml_data_view(mld, order, {ml_data_view::ml_row_range(training_size, mld.size())});
+}
+
+
+std::shared_ptr<const ml_vector<ml_uint>> shuffled_rows(std::size_t size, ml_rng &rng) {
+  auto order = std::make_shared<ml_vector<ml_uint>>(size);
+  for(std::size_t ii = 0; ii < size; ++ii) {
+    (*order)[ii] = ii;
+  }
+
+  if(size > 0) {
+    shuffle_vector(*order, rng);
+  }
+
+  return(order);
+}
+
+
+ml_data_view::ml_data_view(const ml_data &mld, const std::shared_ptr<const ml_vector<ml_uint>> &order, 
+			   const ml_vector<ml_row_range> &ranges) : mld_(&mld), order_(order) {
+  for(const auto &range : ranges) {
+    if(range.second > range.first) {
+      ranges_.push_back(range);
+      size_ += range.second - range.first;
+    }
+  }
+}
+
+
+ml_data ml_data_view::to_data() const {
+  ml_data mld;
+  mld.reserve(size_);
+  for(const auto &range : ranges_) {
+    for(std::size_t position = range.first; position < range.second; ++position) {
+      mld.push_back((*mld_)[order_ ? (*order_)[position] : position]);
+    }
+  }
+  return(mld);
+}
+
+
+static void fillJSONObjectFromInstanceDefinition(json &json_mlid, const ml_instance_definition &mlid) {
+
+  json_mlid["object"] = "ml_instance_definition";
+  json_mlid["version"] = ML_VERSION_STRING;
+  
+  json json_fdescs = json::array();
+  for(std::size_t ii =0; ii < mlid.size(); ++ii) {
+    json json_feature_desc;
+    json_feature_desc["name"] = mlid[ii]->name;
+    json_feature_desc["type"] = mlid[ii]->type;
+    json_feature_desc["missing"] = mlid[ii]->missing;
+    json_feature_desc["preserve_missing"] = mlid[ii]->preserve_missing;
+    
+    if(mlid[ii]->type == ml_feature_type::continuous) {
+      json_feature_desc["mean"] = mlid[ii]->mean;
+      json_feature_desc["sd"] = mlid[ii]->sd;
+    }
+    else {
+      json_feature_desc["discrete_mode_index"] = mlid[ii]->discrete_mode_index;
+
+      json json_values_array = json::array();
+      for(std::size_t jj = 0; jj < mlid[ii]->discrete_values.size(); ++jj) {
+	json_values_array.push_back(mlid[ii]->discrete_values[jj]);
+      }
+      json_feature_desc["discrete_values"] = json_values_array;
+      
+      json json_values_count_array = json::array();
+      for(std::size_t jj = 0; jj < mlid[ii]->discrete_values_count.size(); ++jj) {
+	json_values_count_array.push_back(mlid[ii]->discrete_values_count[jj]);
+      }
+      json_feature_desc["discrete_values_count"] = json_values_count_array;
+      
+    }
+
+    json_fdescs.push_back(json_feature_desc);
+  }
+
+  json_mlid["fdesc_array"] = json_fdescs;
+  
+}
+
+
+static bool createInstanceDefinitionFromJSONObject(const json &json_object, ml_instance_definition &mlid) {
+
+  if(json_object.empty()) {
+    return(false);
+  }
+  
+  ml_string object_name = json_object["object"];
+  if(object_name != "ml_instance_definition") {
+    log_error("json object is not an instance definition...\n");
+    return(false);
+  }
+
+  const json &fdesc_array = json_object["fdesc_array"];
+  if(!fdesc_array.is_array() || (fdesc_array.size() == 0)) {
+    log_error("json object is missing a fdsec array\n");
+    return(false);
+  }
+
+  for(const json &fdesc : fdesc_array) {
+
+    ml_feature_desc_ptr mlfd = std::make_shared<ml_feature_desc>();
+
+    ml_uint fdesc_type=0, fdesc_missing=0;
+    bool fdesc_preserve_missing=false;
+    if(!fdesc.contains<ml_string>("name") ||
+       !fdesc["name"].is_string() ||
+       !get_numeric_value_from_json(fdesc, "type", fdesc_type) ||
+       !get_numeric_value_from_json(fdesc, "missing", fdesc_missing) ||
+       !get_bool_value_from_json(fdesc, "preserve_missing", fdesc_preserve_missing)) {
+      log_error("malformed instance definition\n");
+      return(false);
+    }
+				 
+    mlfd->name = fdesc["name"];
+    mlfd->type = (ml_feature_type) fdesc_type;
+    mlfd->missing = fdesc_missing;
+    mlfd->preserve_missing = fdesc_preserve_missing;
+    
+    if(mlfd->type == ml_feature_type::continuous) {
+      ml_float fdesc_mean=0.0, fdesc_sd=0.0;
+      if(!get_float_value_from_json(fdesc, "mean", fdesc_mean) ||
+	 !get_float_value_from_json(fdesc, "sd", fdesc_sd)) {
+	log_error("missing mean/sd from instance definition\n");
+	return(false);
+      }
+      mlfd->mean = fdesc_mean;
+      mlfd->sd = fdesc_sd;
+    }
+    else {
+      ml_uint dmi=0;
+      if(!get_numeric_value_from_json(fdesc, "discrete_mode_index", dmi)) {
+	log_error("missing discrete feature index\n");
+	return(false);
+      }
+      
+      mlfd->discrete_mode_index = dmi;
+
+      if(!fdesc.contains<ml_string>("discrete_values") ||
+	 !fdesc["discrete_values"].is_array()) {
+	log_error("missing discrete feature values\n");
+	return(false);
+      }
+      
+      const json &values_array = fdesc["discrete_values"];
+      for(ml_uint jj=0; jj < values_array.size(); ++jj) {
+	mlfd->discrete_values.push_back(values_array[jj]);
+	mlfd->discrete_values_map[values_array[jj]] = jj;
+      }
+
+      if(!fdesc.contains<ml_string>("discrete_values_count") ||
+	 !fdesc["discrete_values_count"].is_array()) {
+	log_error("missing discrete feature values counts\n");
+	return(false);
+      }
+      
+      const json &values_count_array = fdesc["discrete_values_count"];
+      for(ml_uint jj=0; jj < values_count_array.size(); ++jj) {
+	mlfd->discrete_values_count.push_back(values_count_array[jj]);
+      }
+    }
+    
+    mlid.push_back(mlfd);
+  }
+
+  return(true);
+}
+
+
+bool write_instance_definition_to_file(const ml_string &path_to_file, 
+				       const ml_instance_definition &mlid) {
+  json json_mlid;
+  fillJSONObjectFromInstanceDefinition(json_mlid, mlid);
+  std::ofstream mlidout(path_to_file);
+  mlidout << std::setw(4) << json_mlid << std::endl; 
+
+  return(true);
+}
+
+
+bool read_instance_definition_from_file(const ml_string &path_to_file, ml_instance_definition &mlid) {
+  mlid.clear();
+  std::ifstream jsonfile(path_to_file);
+  json json_mlid;
+  jsonfile >> json_mlid;
+
+  bool status = createInstanceDefinitionFromJSONObject(json_mlid, mlid);
+
+  return(status);
+}
+
+
+//
+// Binary dataset format. The header is followed by the instance definition 
+// json and then one array of ml_feature_value per feature (column). Values are 
+// stored in native byte order, the header records the layout so files written 
+// on an incompatible machine/build are rejected. When the file is used as a 
+// cache for a csv file, the csv size and modification time are recorded too.
+//
+static const char ML_BINARY_MAGIC[8] = {'P', 'U', 'M', 'L', 'B', 'I', 'N', '\0'};
+static const uint32_t ML_BINARY_FORMAT_VERSION = 1;
+static const uint32_t ML_BINARY_BYTE_ORDER_MARK = 0x01020304;
+static const ml_string ML_BINARY_CACHE_SUFFIX = ".pumlbin";
+
+struct ml_binary_header {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t byte_order_mark;
+  uint32_t value_size;
+  uint32_t feature_count;
+  uint64_t instance_count;
+  uint64_t source_size;
+  int64_t source_mtime;
+  uint64_t mlid_json_size;
+};
+
+
+static uint64_t binaryDataOffset(uint64_t mlid_json_size) {
+  uint64_t offset = sizeof(ml_binary_header) + mlid_json_size;
+  return((offset + 7) & ~((uint64_t) 7));
+}
+
+
+static bool sourceFileSizeAndModificationTime(const ml_string &path_to_file, uint64_t &size, int64_t &mtime) {
+  struct stat info;
+  if(stat(path_to_file.c_str(), &info) != 0) {
+    return(false);
+  }
+
+  size = info.st_size;
+  mtime = info.st_mtime;
+  return(true);
+}
+
+
+static bool binaryHeaderIsCompatible(const ml_binary_header &header, const ml_string &path_to_file) {
+  if((memcmp(header.magic, ML_BINARY_MAGIC, sizeof(header.magic)) != 0) ||
+     (header.format_version != ML_BINARY_FORMAT_VERSION) ||
+     (header.byte_order_mark != ML_BINARY_BYTE_ORDER_MARK) ||
+     (header.value_size != sizeof(ml_feature_value))) {
+    log_error("%s is not a compatible binary data file\n", path_to_file.c_str());
+    return(false);
+  }
+
+  return(true);
+}
+
+
+static bool binaryInstanceDefinition(const ml_binary_header &header, const char *mlid_json, 
+				     const ml_string &path_to_file, ml_instance_definition &mlid) {
+  try {
+    json json_mlid = json::parse(mlid_json, mlid_json + header.mlid_json_size);
+    if(createInstanceDefinitionFromJSONObject(json_mlid, mlid) && (mlid.size() == header.feature_count)) {
+      return(true);
+    }
+  }
+  catch(...) {
+  }
+
+  log_error("invalid instance definition in binary data file %s\n", path_to_file.c_str());
+  mlid.clear();
+  return(false);
+}
+
+
+static bool writeDataBinary(const ml_string &path_to_file, const ml_instance_definition &mlid, const ml_data &mld,
+			    uint64_t source_size, int64_t source_mtime) {
+
+  for(const auto &inst_ptr : mld) {
+    if(inst_ptr->size() < mlid.size()) {
+      log_error("feature count mismatch b/t instance definition and instance data\n");
+      return(false);
+    }
+  }
+
+  json json_mlid;
+  fillJSONObjectFromInstanceDefinition(json_mlid, mlid);
+  ml_string mlid_json = json_mlid.dump();
+
+  ml_binary_header header = {};
+  memcpy(header.magic, ML_BINARY_MAGIC, sizeof(header.magic));
+  header.format_version = ML_BINARY_FORMAT_VERSION;
+  header.byte_order_mark = ML_BINARY_BYTE_ORDER_MARK;
+  header.value_size = sizeof(ml_feature_value);
+  header.feature_count = mlid.size();
+  header.instance_count = mld.size();
+  header.source_size = source_size;
+  header.source_mtime = source_mtime;
+  header.mlid_json_size = mlid_json.size();
+
+  //
+  // write to a temporary file and rename so a partial file is never left behind
+  //
+  ml_string temp_path = path_to_file + ".tmp";
+  std::ofstream out(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!out) {
+    log_error("can't write binary data file %s\n", temp_path.c_str());
+    return(false);
+  }
+
+  out.write((const char *) &header, sizeof(header));
+  out.write(mlid_json.data(), mlid_json.size());
+  
+  ml_string padding(binaryDataOffset(header.mlid_json_size) - sizeof(header) - mlid_json.size(), '\0');
+  out.write(padding.data(), padding.size());
+
+  ml_vector<ml_feature_value> column(mld.size());
+  for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
+    for(std::size_t ii = 0; ii < mld.size(); ++ii) {
+      column[ii] = (*mld[ii])[findex];
+    }
+    out.write((const char *) column.data(), column.size() * sizeof(ml_feature_value));
+  }
+
+  out.close();
+  if(!out || (rename(temp_path.c_str(), path_to_file.c_str()) != 0)) {
+    log_error("failed writing binary data file %s\n", path_to_file.c_str());
+    remove(temp_path.c_str());
+    return(false);
+  }
+
+  return(true);
+}
+
+
+static bool readDataBinary(const ml_string &path_to_file, ml_instance_definition &mlid, ml_data &mld,
+			   bool check_source, uint64_t source_size, int64_t source_mtime) {
+
+  mlid.clear();
+  mld.clear();
+
+  ml_mapped_file mapped_file;
+  if(!mapped_file.open(path_to_file)) {
+    return(false);
+  }
+
+  ml_binary_header header = {};
+  if(mapped_file.size() < sizeof(header)) {
+    log_error("%s is not a binary data file\n", path_to_file.c_str());
+    return(false);
+  }
+
+  memcpy(&header, mapped_file.data(), sizeof(header));
+  if(!binaryHeaderIsCompatible(header, path_to_file)) {
+    return(false);
+  }
+
+  if(check_source && ((header.source_size != source_size) || (header.source_mtime != source_mtime))) {
+    return(false);
+  }
+
+  uint64_t data_offset = binaryDataOffset(header.mlid_json_size);
+  uint64_t data_size = header.feature_count * header.instance_count * header.value_size;
+  if((data_offset > mapped_file.size()) || (data_size > (mapped_file.size() - data_offset))) {
+    log_error("binary data file %s is truncated\n", path_to_file.c_str());
+    return(false);
+  }
+
+  const char *mlid_json = mapped_file.data() + sizeof(header);
+  if(!binaryInstanceDefinition(header, mlid_json, path_to_file, mlid)) {
+    return(false);
+  }
+
+  //
+  // columns -> instances
+  //
+  const ml_feature_value *columns = (const ml_feature_value *) (mapped_file.data() + data_offset);
+  mld.reserve(header.instance_count);
+  for(uint64_t ii = 0; ii < header.instance_count; ++ii) {
+    ml_instance_ptr mli = std::make_shared<ml_instance>(header.feature_count);
+    ml_instance &instance = *mli;
+    for(uint64_t findex = 0; findex < header.feature_count; ++findex) {
+      instance[findex] = columns[(findex * header.instance_count) + ii];
+    }
+    mld.push_back(mli);
+  }
+
+  return(true);
+}
+
+
+bool save_data_binary(const ml_string &path_to_file, const ml_instance_definition &mlid, const ml_data &mld) {
+  return(writeDataBinary(path_to_file, mlid, mld, 0, 0));
+}
+
+
+bool load_data_binary(const ml_string &path_to_file, ml_instance_definition &mlid, ml_data &mld) {
+  if(!readDataBinary(path_to_file, mlid, mld, false, 0, 0)) {
+    log_error("can't load binary data file %s\n", path_to_file.c_str());
+    return(false);
+  }
+
+  return(true);
+}
+
+
+static bool loadDataWithBinaryCache(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld,
+				    const ml_load_options &options) {
+
+  uint64_t source_size = 0;
+  int64_t source_mtime = 0;
+  if(!sourceFileSizeAndModificationTime(path_to_input_file, source_size, source_mtime)) {
+    log_error("can't open input file %s\n", path_to_input_file.c_str());
+    return(false);
+  }
+
+  //
+  // a projection (columns) or kept missing values get their own cache file
+  //
+  ml_string path_to_cache_file = path_to_input_file + ML_BINARY_CACHE_SUFFIX;
+  if(!options.columns.empty() || options.keep_missing) {
+    ml_string columns;
+    for(const auto &column : options.columns) {
+      columns += column + ML_CSV_DELIM;
+    }
+    columns += options.keep_missing ? ("?" + options.feature_to_predict) : "";
+    
+    std::ostringstream ss;
+    ss << path_to_input_file << "." << std::hex << std::setw(16) << std::setfill('0') 
+       << (uint64_t) ml_string_ref_hash()(ml_string_ref{columns.data(), columns.size()}) << ML_BINARY_CACHE_SUFFIX;
+    path_to_cache_file = ss.str();
+  }
+  if(readDataBinary(path_to_cache_file, mlid, mld, true, source_size, source_mtime)) {
+    return(true);
+  }
+
+  ml_load_options csv_options = options;
+  csv_options.use_binary_cache = false;
+  if(!load_data(path_to_input_file, mlid, mld, csv_options)) {
+    return(false);
+  }
+
+  if(!writeDataBinary(path_to_cache_file, mlid, mld, source_size, source_mtime)) {
+    log_warn("couldn't write binary cache file %s\n", path_to_cache_file.c_str());
+  }
+
+  return(true);
+}
+
+
+//
+// ml_data_reader: csv text is read in blocks (see ml_line_reader) and each chunk of lines
+// is parsed in place (in parallel) like load_data(). Binary files are read a column 
+// range at a time.
+//
+ml_data_reader::ml_data_reader(const ml_string &path_to_input_file, const ml_instance_definition &mlid,
+			       ml_uint instances_per_chunk, const ml_load_options &options) :
+  path_(path_to_input_file), instances_per_chunk_((instances_per_chunk > 0) ? instances_per_chunk : 1), options_(options) {
+
+  status_ = open(mlid);
+}
+
+
+ml_data_reader::~ml_data_reader() {
+}
+
+
+static void copyInstanceDefinition(const ml_instance_definition &mlid, ml_instance_definition &mlid_copy) {
+  mlid_copy.clear();
+  for(const auto &mlfd : mlid) {
+    mlid_copy.push_back(std::make_shared<ml_feature_desc>(*mlfd));
+  }
+}
+
+
+bool ml_data_reader::open(const ml_instance_definition &mlid) {
+
+  status_ = true; // cleared if a chunk read while opening fails (see scan_instance_definition)
+
+  input_.reset(new ml_line_reader());
+  if(!input_->open(path_)) {
+    log_error("can't open input file %s\n", path_.c_str());
+    return(false);
+  }
+
+  char magic[sizeof(ML_BINARY_MAGIC)] = {};
+  binary_ = (input_->input().read(magic, sizeof(magic)) == sizeof(magic)) && (memcmp(magic, ML_BINARY_MAGIC, sizeof(magic)) == 0);
+  if(binary_ && input_->input().compressed()) {
+    log_error("compressed binary data file %s isn't supported\n", path_.c_str());
+    return(false);
+  }
+
+  if(!input_->seek(0)) {
+    log_error("can't read input file %s\n", path_.c_str());
+    return(false);
+  }
+
+  return(binary_ ? open_binary(mlid) : open_csv(mlid));
+}
+
+
+bool ml_data_reader::open_csv(const ml_instance_definition &mlid) {
+
+  ml_instance_definition mlid_temp;
+  if(!readInstanceDefinitionLine(*input_, path_, options_.columns, mlid_temp, ignored_columns_, line_number_)) {
+    return(false);
+  }
+
+  data_begin_ = input_->position();
+  header_lines_ = line_number_;
+
+  if(mlid.empty()) {
+    mlid_ = mlid_temp;
+    return(scan_instance_definition());
+  }
+
+  if(!instanceDefinitionsMatchInCountTypeAndName(mlid, mlid_temp)) {
+    log_error("file format doesn't match preloaded instance definition\n");
+    return(false);
+  }
+
+  copyInstanceDefinition(mlid, mlid_);
+  return(true);
+}
+
+
+bool ml_data_reader::open_binary(const ml_instance_definition &mlid) {
+
+  ml_file_reader &input = input_->input();
+
+  ml_binary_header header = {};
+  if(input.read((char *) &header, sizeof(header)) != sizeof(header)) {
+    log_error("%s is not a binary data file\n", path_.c_str());
+    return(false);
+  }
+
+  if(!binaryHeaderIsCompatible(header, path_)) {
+    return(false);
+  }
+
+  if(!options_.columns.empty()) {
+    log_warn("columns option is ignored for binary data file %s\n", path_.c_str());
+  }
+
+  ml_string mlid_json(header.mlid_json_size, '\0');
+  input.read(&mlid_json[0], mlid_json.size());
+
+  uint64_t file_size = 0;
+  int64_t file_mtime = 0;
+  sourceFileSizeAndModificationTime(path_, file_size, file_mtime);
+
+  data_offset_ = binaryDataOffset(header.mlid_json_size);
+  uint64_t data_size = header.feature_count * header.instance_count * header.value_size;
+  if((data_offset_ > file_size) || (data_size > (file_size - data_offset_))) {
+    log_error("binary data file %s is truncated\n", path_.c_str());
+    return(false);
+  }
 
-  return(true);
-}
+  ml_instance_definition mlid_file;
+  if(!binaryInstanceDefinition(header, mlid_json.data(), path_, mlid_file)) {
+    return(false);
+  }
 
-bool load_data_using_instance_definition(const ml_string &path_to_input_file, 
-					 const ml_instance_definition &mlid, 
-					 ml_data &mld, ml_vector<ml_string> *ids) {
+  instance_count_ = header.instance_count;
+  instance_count_known_ = true;
 
-  ml_instance_definition temp_mlid(mlid);
-  if(!loadInstanceDataFromFile(path_to_input_file, temp_mlid, mld, ids)) {
+  if(mlid.empty()) {
+    mlid_ = mlid_file;
+    return(true);
+  }
+
+  if(!instanceDefinitionsMatchInCountTypeAndName(mlid, mlid_file)) {
+    log_error("file format doesn't match preloaded instance definition\n");
     return(false);
   }
 
-  if(!instanceDefinitionsMatch(mlid, temp_mlid, true)) {
-    mld.clear();
-    log_error("file format doesn't match preloaded instance definition...\n");
+  //
+  // discrete values in the file are indices into the file's categories, map them to mlid's
+  //
+  copyInstanceDefinition(mlid, mlid_);
+  discrete_index_remap_.resize(mlid_.size());
+  for(std::size_t findex = 0; findex < mlid_.size(); ++findex) {
+    if(mlid_[findex]->type != ml_feature_type::discrete) {
+      continue;
+    }
+
+    for(const auto &value : mlid_file[findex]->discrete_values) {
+      discrete_index_remap_[findex].push_back(findDiscreteValueIndexForValue(value, *mlid_[findex]));
+    }
   }
 
   return(true);
 }
 
-bool load_data(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld) {
-  mlid.clear();
-  return(loadInstanceDataFromFile(path_to_input_file, mlid, mld, nullptr));
-}
 
-void print_data_summary(const ml_instance_definition &mlid) {
+bool ml_data_reader::scan_instance_definition() {
 
-  log("\n\n*** Data Summary ***\n\n");
+  //
+  // one pass over the data to find the categories, mean/sd and mode of each feature
+  //
+  ml_vector<ml_stats_helper> stats_helper(mlid_.size(), ml_stats_helper());
+  ml_data mld;
 
-  for(std::size_t ii = 0; ii < mlid.size(); ++ii) {
-    log("feature %zu: %s, missing: %d\n", ii, mlid[ii]->name.c_str(), mlid[ii]->missing);
-    if(mlid[ii]->type == ml_feature_type::continuous) {
-      log("     mean: %.3f  std: %.3f\n\n", mlid[ii]->mean, mlid[ii]->sd);
-    }
-    else {
-      const ml_feature_desc &mlfd = *mlid[ii];
-      for(std::size_t jj=1; jj < mlfd.discrete_values.size(); ++jj) {
-	log("  category %zu: %s, count: %d\n", jj, mlfd.discrete_values[jj].c_str(), mlfd.discrete_values_count[jj]);
-      }
-      log("\n");
+  instance_count_ = 0;
+  while(read_csv_chunk(mld, stats_helper)) {
+    instance_count_ += mld.size();
+    mld.clear();
+    for(auto &sh : stats_helper) {
+      sh.missing_data_instance_indices.clear();
     }
   }
 
+  if(!status_) {
+    return(false);
+  }
+
+  instance_count_known_ = true;
+  calcMeanOrModeOfFeatures(mlid_, mld, stats_helper);
+
+  return(rewind());
 }
 
 
-void split_data_into_training_and_test(ml_data &mld, ml_float training_factor, 
-				       ml_data &training, ml_data &test,
-				       ml_uint seed) {
-  
-  training.clear();
-  test.clear();
+bool ml_data_reader::read_csv_chunk(ml_data &mld, ml_vector<ml_stats_helper> &stats_helper) {
 
-  if(mld.empty()) {
-    return;
+  //
+  // chunks made up of empty lines are skipped
+  //
+  const char *begin = nullptr, *end = nullptr;
+  ml_uint lines = 0;
+  while(mld.empty() && input_->next_lines(instances_per_chunk_, std::numeric_limits<std::size_t>::max(), begin, end, lines)) {
+    ml_uint first_line = line_number_;
+    line_number_ += lines;
+
+    //
+    // the missing and category counts of mlid_ include each line once (lines read
+    // again after a rewind, or after the scan, aren't counted)
+    //
+    bool count_values = (first_line >= counted_lines_);
+    if(!parseInstanceLines(begin, end, first_line, options_, mlid_, ignored_columns_, mld, stats_helper, nullptr, count_values)) {
+      status_ = false;
+      mld.clear();
+      return(false);
+    }
+
+    if(count_values) {
+      counted_lines_ = line_number_;
+    }
   }
- 
-  if(training_factor > 0.99) {
-    log_error("bogus training factor %.2f\n", training_factor);
-    return;
+
+  if(input_->input().failed()) {
+    status_ = false;
+    mld.clear();
   }
 
-  ml_rng rng(seed);
-  shuffle_vector(mld, rng);
-  ml_uint training_size = (ml_uint) ((training_factor * mld.size()) + 0.5);
-  training = ml_data(mld.begin(), mld.begin() + training_size);
-  mld.erase(mld.begin(), mld.begin() + training_size);
-  test = ml_data(mld.begin(), mld.end());
+  return(!mld.empty());
 }
 
 
-static void fillJSONObjectFromInstanceDefinition(json &json_mlid, const ml_instance_definition &mlid) {
+bool ml_data_reader::read_binary_chunk(ml_data &mld) {
 
-  json_mlid["object"] = "ml_instance_definition";
-  json_mlid["version"] = ML_VERSION_STRING;
-  
-  json json_fdescs = json::array();
-  for(std::size_t ii =0; ii < mlid.size(); ++ii) {
-    json json_feature_desc;
-    json_feature_desc["name"] = mlid[ii]->name;
-    json_feature_desc["type"] = mlid[ii]->type;
-    json_feature_desc["missing"] = mlid[ii]->missing;
-    json_feature_desc["preserve_missing"] = mlid[ii]->preserve_missing;
+  if(position_ >= instance_count_) {
+    return(false);
+  }
+
+  std::size_t count = std::min<uint64_t>(instances_per_chunk_, instance_count_ - position_);
+  mld.reserve(count);
+  for(std::size_t ii = 0; ii < count; ++ii) {
+    mld.push_back(std::make_shared<ml_instance>(mlid_.size()));
+  }
+
+  ml_file_reader &input = input_->input();
+  ml_vector<ml_feature_value> column(count);
+  for(std::size_t findex = 0; findex < mlid_.size(); ++findex) {
     
-    if(mlid[ii]->type == ml_feature_type::continuous) {
-      json_feature_desc["mean"] = mlid[ii]->mean;
-      json_feature_desc["sd"] = mlid[ii]->sd;
+    std::size_t column_bytes = count * sizeof(ml_feature_value);
+    if(!input.seek(data_offset_ + ((findex * instance_count_) + position_) * sizeof(ml_feature_value)) ||
+       (input.read((char *) column.data(), column_bytes) != column_bytes)) {
+      log_error("failed reading binary data file %s\n", path_.c_str());
+      status_ = false;
+      mld.clear();
+      return(false);
     }
-    else {
-      json_feature_desc["discrete_mode_index"] = mlid[ii]->discrete_mode_index;
 
-      json json_values_array = json::array();
-      for(std::size_t jj = 0; jj < mlid[ii]->discrete_values.size(); ++jj) {
-	json_values_array.push_back(mlid[ii]->discrete_values[jj]);
-      }
-      json_feature_desc["discrete_values"] = json_values_array;
-      
-      json json_values_count_array = json::array();
-      for(std::size_t jj = 0; jj < mlid[ii]->discrete_values_count.size(); ++jj) {
-	json_values_count_array.push_back(mlid[ii]->discrete_values_count[jj]);
+    const ml_vector<ml_uint> *remap = (findex < discrete_index_remap_.size()) ? &discrete_index_remap_[findex] : nullptr;
+    for(std::size_t ii = 0; ii < count; ++ii) {
+      ml_feature_value &mlfv = (*mld[ii])[findex];
+      mlfv = column[ii];
+      if(remap && (mlfv.discrete_value_index < remap->size())) {
+	mlfv.discrete_value_index = (*remap)[mlfv.discrete_value_index];
       }
-      json_feature_desc["discrete_values_count"] = json_values_count_array;
-      
     }
-
-    json_fdescs.push_back(json_feature_desc);
   }
 
-  json_mlid["fdesc_array"] = json_fdescs;
-  
+  return(true);
 }
 
 
-static bool createInstanceDefinitionFromJSONObject(const json &json_object, ml_instance_definition &mlid) {
+bool ml_data_reader::read_chunk(ml_data &mld) {
 
-  if(json_object.empty()) {
+  mld.clear();
+  if(!status_) {
     return(false);
   }
-  
-  ml_string object_name = json_object["object"];
-  if(object_name != "ml_instance_definition") {
-    log_error("json object is not an instance definition...\n");
-    return(false);
+
+  if(binary_) {
+    read_binary_chunk(mld);
+  }
+  else {
+    ml_vector<ml_stats_helper> stats_helper(mlid_.size(), ml_stats_helper());
+    read_csv_chunk(mld, stats_helper);
+    fillMissingInstanceFeatureValues(mlid_, mld, stats_helper);
   }
 
-  const json &fdesc_array = json_object["fdesc_array"];
-  if(!fdesc_array.is_array() || (fdesc_array.size() == 0)) {
-    log_error("json object is missing a fdsec array\n");
+  position_ += mld.size();
+  return(!mld.empty());
+}
+
+
+bool ml_data_reader::rewind() {
+
+  if(!input_) {
     return(false);
   }
 
-  for(const json &fdesc : fdesc_array) {
+  position_ = 0;
+  line_number_ = header_lines_;
 
-    ml_feature_desc_ptr mlfd = std::make_shared<ml_feature_desc>();
+  status_ = binary_ ? true : input_->seek(data_begin_);
+  return(status_);
+}
 
-    ml_uint fdesc_type=0, fdesc_missing=0;
-    bool fdesc_preserve_missing=false;
-    if(!fdesc.contains<ml_string>("name") ||
-       !fdesc["name"].is_string() ||
-       !get_numeric_value_from_json(fdesc, "type", fdesc_type) ||
-       !get_numeric_value_from_json(fdesc, "missing", fdesc_missing) ||
-       !get_bool_value_from_json(fdesc, "preserve_missing", fdesc_preserve_missing)) {
-      log_error("malformed instance definition\n");
-      return(false);
-    }
-				 
-    mlfd->name = fdesc["name"];
-    mlfd->type = (ml_feature_type) fdesc_type;
-    mlfd->missing = fdesc_missing;
-    mlfd->preserve_missing = fdesc_preserve_missing;
-    
-    if(mlfd->type == ml_feature_type::continuous) {
-      ml_float fdesc_mean=0.0, fdesc_sd=0.0;
-      if(!get_float_value_from_json(fdesc, "mean", fdesc_mean) ||
-	 !get_float_value_from_json(fdesc, "sd", fdesc_sd)) {
-	log_error("missing mean/sd from instance definition\n");
-	return(false);
-      }
-      mlfd->mean = fdesc_mean;
-      mlfd->sd = fdesc_sd;
-    }
-    else {
-      ml_uint dmi=0;
-      if(!get_numeric_value_from_json(fdesc, "discrete_mode_index", dmi)) {
-	log_error("missing discrete feature index\n");
-	return(false);
-      }
-      
-      mlfd->discrete_mode_index = dmi;
 
-      if(!fdesc.contains<ml_string>("discrete_values") ||
-	 !fdesc["discrete_values"].is_array()) {
-	log_error("missing discrete feature values\n");
-	return(false);
-      }
-      
-      const json &values_array = fdesc["discrete_values"];
-      for(ml_uint jj=0; jj < values_array.size(); ++jj) {
-	mlfd->discrete_values.push_back(values_array[jj]);
-	mlfd->discrete_values_map[values_array[jj]] = jj;
-      }
+uint64_t ml_data_reader::instance_count() {
 
-      if(!fdesc.contains<ml_string>("discrete_values_count") ||
-	 !fdesc["discrete_values_count"].is_array()) {
-	log_error("missing discrete feature values counts\n");
-	return(false);
+  if(instance_count_known_ || !status_) {
+    return(instance_count_);
+  }
+
+  //
+  // count the lines with at least two fields (without parsing them)
+  //
+  ml_file_reader input;
+  if(!input.open(path_) || !input.seek(data_begin_)) {
+    return(0);
+  }
+
+  ml_string block(ML_LOAD_MIN_CHUNK_BYTES, '\0');
+  bool delimiter_in_line = false;
+  std::size_t bytes_read = 0;
+  instance_count_ = 0;
+  while((bytes_read = input.read(&block[0], block.size())) > 0) {
+    for(std::size_t ii = 0; ii < bytes_read; ++ii) {
+      if(block[ii] == ML_CSV_DELIM) {
+	delimiter_in_line = true;
       }
-      
-      const json &values_count_array = fdesc["discrete_values_count"];
-      for(ml_uint jj=0; jj < values_count_array.size(); ++jj) {
-	mlfd->discrete_values_count.push_back(values_count_array[jj]);
+      else if(block[ii] == '\n') {
+	instance_count_ += delimiter_in_line ? 1 : 0;
+	delimiter_in_line = false;
       }
     }
-    
-    mlid.push_back(mlfd);
   }
 
-  return(true);
-}
-
-
-bool write_instance_definition_to_file(const ml_string &path_to_file, 
-				       const ml_instance_definition &mlid) {
-  json json_mlid;
-  fillJSONObjectFromInstanceDefinition(json_mlid, mlid);
-  std::ofstream mlidout(path_to_file);
-  mlidout << std::setw(4) << json_mlid << std::endl; 
+  instance_count_ += delimiter_in_line ? 1 : 0;
+  instance_count_known_ = true;
 
-  return(true);
+  return(instance_count_);
 }
 
 
-bool read_instance_definition_from_file(const ml_string &path_to_file, ml_instance_definition &mlid) {
-  mlid.clear();
-  std::ifstream jsonfile(path_to_file);
-  json json_mlid;
-  jsonfile >> json_mlid;
-
-  bool status = createInstanceDefinitionFromJSONObject(json_mlid, mlid);
-
-  return(status);
-}
+//
+// where the features of an instance go in the one hot encoding: the index of the 
+// copied feature, or of the first category column of an encoded discrete feature
+//
+struct ml_ohe_layout {
+  ml_vector<ml_uint> feature_index;
+  ml_vector<bool> encoded;
+  ml_vector<ml_uint> category_counts; // per ohe feature, instances with the category (1.0)
+};
 
 
 static void createOneHotEncodingInstanceDefinition(const ml_instance_definition &mlid, const ml_string &name_of_index_to_predict, 
-						   ml_instance_definition &mlid_ohe, ml_vector<ml_stats_helper> &stats_helper) {
+						   ml_instance_definition &mlid_ohe, ml_ohe_layout &layout) {
   //
   // create the new mlid with discrete feature categories mapped to continuous features
   //
   for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
     const ml_feature_desc &fdesc = *mlid[findex];
+    layout.feature_index.push_back(mlid_ohe.size());
     if((fdesc.type == ml_feature_type::continuous) || (fdesc.name == name_of_index_to_predict)) {
+      layout.encoded.push_back(false);
       mlid_ohe.push_back(mlid[findex]);
-      ml_stats_helper sh = {};
-      stats_helper.push_back(sh);
     }
     else {
+      layout.encoded.push_back(true);
       for(std::size_t value_index = (fdesc.preserve_missing ? 0 : 1); value_index < fdesc.discrete_values.size(); ++value_index) {
 	ml_feature_desc_ptr ohe_fdesc = std::make_shared<ml_feature_desc>();
 	ohe_fdesc->type = ml_feature_type::continuous;
 	ohe_fdesc->name = fdesc.name + "_" + fdesc.discrete_values[value_index];
 	mlid_ohe.push_back(ohe_fdesc);
-	ml_stats_helper sh = {};
-	stats_helper.push_back(sh);
       }
     }
   }
+
+  layout.category_counts.assign(mlid_ohe.size(), 0);
+}
+
+
+//
+// the (one hot encoded feature index, value) entries of an instance. an encoded 
+// discrete feature has one entry (1.0) for the instance's category, or none if the 
+// category has no column (missing values that aren't preserved)
+//
+static void oneHotEncodingEntriesForInstance(const ml_instance_definition &mlid, const ml_instance &inst, ml_ohe_layout &layout,
+					     ml_vector<std::pair<ml_uint, ml_feature_value>> &entries) {
+  entries.clear();
+
+  for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
+    if(!layout.encoded[findex]) {
+      entries.push_back(std::make_pair(layout.feature_index[findex], inst[findex]));
+      continue;
+    }
+
+    const ml_feature_desc &fdesc = *mlid[findex];
+    ml_uint first_value_index = fdesc.preserve_missing ? 0 : 1;
+    ml_uint value_index = inst[findex].discrete_value_index;
+    if((value_index < first_value_index) || (value_index >= fdesc.discrete_values.size())) {
+      continue;
+    }
+
+    ml_uint ohe_findex = layout.feature_index[findex] + (value_index - first_value_index);
+    ml_feature_value fv_ohe = {};
+    fv_ohe.continuous_value = 1.0;
+    entries.push_back(std::make_pair(ohe_findex, fv_ohe));
+    layout.category_counts[ohe_findex] += 1;
+  }
 }
 
+
 static void createOneHotEncodingForData(const ml_instance_definition &mlid, const ml_data &mld, 
-					const ml_string &name_of_feature_to_predict,
-					ml_data &mld_ohe, ml_vector<ml_stats_helper> &stats_helper) {
+					const ml_instance_definition &mlid_ohe, ml_ohe_layout &layout,
+					ml_data &mld_ohe) {
   //
   // convert the instances to the new one hot encoded format
   //
+  ml_vector<std::pair<ml_uint, ml_feature_value>> entries;
   for(std::size_t ii=0; ii < mld.size(); ++ii) {
-    const ml_instance &inst = *mld[ii];
-    ml_instance_ptr inst_ohe = std::make_shared<ml_instance>();
-    
-    for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
-      const ml_feature_desc &fdesc = *mlid[findex];
-   
-      // just copy the continuous features (and feature to predict)
-      if((fdesc.type == ml_feature_type::continuous) || (fdesc.name == name_of_feature_to_predict)) {
-	inst_ohe->push_back(inst[findex]);
-      }
-      else { // use 1.0 for the ohe feature that represents this instance's category of the original discrete feature, 0.0 otherwise.
-	for(std::size_t value_index = (fdesc.preserve_missing ? 0 : 1); value_index < fdesc.discrete_values.size(); ++value_index) {
-	  ml_feature_value fv_ohe = {};
-	  fv_ohe.continuous_value = (inst[findex].discrete_value_index == value_index) ? 1.0 : 0.0;
-	  updateStatsHelperWithFeatureValue(stats_helper[inst_ohe->size()], fv_ohe);
-	  inst_ohe->push_back(fv_ohe);
-	}
-      }
+    ml_instance_ptr inst_ohe = std::make_shared<ml_instance>(mlid_ohe.size());
+    oneHotEncodingEntriesForInstance(mlid, *mld[ii], layout, entries);
+    for(const auto &entry : entries) {
+      (*inst_ohe)[entry.first] = entry.second;
     }
 
     mld_ohe.push_back(inst_ohe);
   }
 }
 
-static void updateStatsForOneHotEncoding(ml_instance_definition &mlid_ohe, const ml_vector<ml_stats_helper> &stats_helper) {
+
+static void createOneHotEncodingForData(const ml_instance_definition &mlid, const ml_data &mld, 
+					ml_ohe_layout &layout, ml_sparse_data &mlsd_ohe) {
+  //
+  // convert the instances to sparse one hot encoded rows
+  //
+  ml_vector<std::pair<ml_uint, ml_feature_value>> entries;
+  for(std::size_t ii=0; ii < mld.size(); ++ii) {
+    oneHotEncodingEntriesForInstance(mlid, *mld[ii], layout, entries);
+    mlsd_ohe.add_instance(entries);
+  }
+}
+
+
+static void updateStatsForOneHotEncoding(const ml_instance_definition &mlid, ml_instance_definition &mlid_ohe, 
+					 const ml_ohe_layout &layout, std::size_t instance_count) {
   //
-  // update the new ml_instance_defintion with mean/sd for the encoded features
+  // update the new ml_instance_defintion with mean/sd for the encoded features. a 
+  // category column with k ones in n instances has mean k/n and variance k(n-k)/(n(n-1))
   //
-  for(std::size_t findex = 0; findex < mlid_ohe.size(); ++findex) {
-    if(stats_helper[findex].count == 0) {
+  if(instance_count == 0) {
+    return;
+  }
+
+  ml_double n = instance_count;
+  for(std::size_t findex = 0; findex < mlid.size(); ++findex) {
+    if(!layout.encoded[findex]) {
       continue;
     }
 
-    mlid_ohe[findex]->mean = stats_helper[findex].mean;
-    mlid_ohe[findex]->sd = (stats_helper[findex].count < 2) ? 0.0 : (sqrt(stats_helper[findex].M2 / (stats_helper[findex].count - 1)));
+    ml_uint categories = mlid[findex]->discrete_values.size() - (mlid[findex]->preserve_missing ? 0 : 1);
+    for(ml_uint ohe_findex = layout.feature_index[findex]; ohe_findex < (layout.feature_index[findex] + categories); ++ohe_findex) {
+      ml_double k = layout.category_counts[ohe_findex];
+      mlid_ohe[ohe_findex]->mean = k / n;
+      mlid_ohe[ohe_findex]->sd = (instance_count < 2) ? 0.0 : sqrt((k * (n - k)) / (n * (n - 1)));
+    }
   }
 
 }
@@ -691,10 +2597,25 @@ bool create_onehotencoding_for_data(const ml_instance_definition &mlid, const ml
   mlid_ohe.clear();
   mld_ohe.clear();
 
-  ml_vector<ml_stats_helper> stats_helper;
-  createOneHotEncodingInstanceDefinition(mlid, name_of_feature_to_predict, mlid_ohe, stats_helper);
-  createOneHotEncodingForData(mlid, mld, name_of_feature_to_predict, mld_ohe, stats_helper);
-  updateStatsForOneHotEncoding(mlid_ohe, stats_helper);
+  ml_ohe_layout layout;
+  createOneHotEncodingInstanceDefinition(mlid, name_of_feature_to_predict, mlid_ohe, layout);
+  createOneHotEncodingForData(mlid, mld, mlid_ohe, layout, mld_ohe);
+  updateStatsForOneHotEncoding(mlid, mlid_ohe, layout, mld.size());
+
+  return(true);
+}
+
+bool create_onehotencoding_for_data(const ml_instance_definition &mlid, const ml_data &mld, 
+				    const ml_string &name_of_feature_to_predict, 
+				    ml_instance_definition &mlid_ohe, ml_sparse_data &mlsd_ohe) {
+
+  mlid_ohe.clear();
+  mlsd_ohe.clear();
+
+  ml_ohe_layout layout;
+  createOneHotEncodingInstanceDefinition(mlid, name_of_feature_to_predict, mlid_ohe, layout);
+  createOneHotEncodingForData(mlid, mld, layout, mlsd_ohe);
+  updateStatsForOneHotEncoding(mlid, mlid_ohe, layout, mld.size());
 
   return(true);
 }
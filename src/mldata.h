@@ -22,6 +22,7 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdlib>
 #include <memory>
 #include <random>
 #include <stdint.h>
@@ -168,13 +169,162 @@ using ml_instance_ptr = std::shared_ptr<ml_instance>;
 using ml_data =  ml_vector<ml_instance_ptr>;
 
 
+//
+// ml_data_view is a dataset made of rows of an ml_data without copying them: ranges
+// of positions in a row order, either a permutation of the rows (shared by the 
+// views made from it) or the rows as they are. Cross-validation folds and training/
+// test splits are views of one permutation. A view refers to the data, which must
+// outlive it and not change.
+//
+class ml_data_view final {
+ public:
+  using ml_row_range = std::pair<std::size_t, std::size_t>; // [begin, end) positions in the order
+
+  ml_data_view() {}
+
+  // all rows of mld in order
+  explicit ml_data_view(const ml_data &mld) : mld_(&mld), ranges_{ml_row_range(0, mld.size())}, size_(mld.size()) {}
+
+  // the rows of mld at positions in ranges of order
+  ml_data_view(const ml_data &mld, const std::shared_ptr<const ml_vector<ml_uint>> &order, 
+	       const ml_vector<ml_row_range> &ranges);
+
+  std::size_t size() const { return(size_); }
+  bool empty() const { return(size_ == 0); }
+
+  // the row of the data for the instance at index (of the view), an index
+  // past the end of the view is a fatal error
+  std::size_t row(std::size_t index) const {
+    std::size_t position = index;
+    for(const auto &range : ranges_) {
+      std::size_t range_size = range.second - range.first;
+      if(position < range_size) {
+	return(order_ ? (*order_)[range.first + position] : (range.first + position));
+      }
+      position -= range_size;
+    }
+    log_error("ml_data_view index %zu out of range (size %zu). aborting...\n", index, size_);
+    abort();
+  }
+
+  const ml_instance_ptr &operator[](std::size_t index) const { return((*mld_)[row(index)]); }
+
+  // copy of the instance pointers (for code that needs an ml_data)
+  ml_data to_data() const;
+
+ private:
+  const ml_data *mld_ = nullptr;
+  std::shared_ptr<const ml_vector<ml_uint>> order_;
+  ml_vector<ml_row_range> ranges_;
+  std::size_t size_ = 0;
+};
+
+
+
+//
+// ml_sparse_data is a dataset in compressed sparse row (CSR) format for high dimensional 
+// data that's mostly zeros. Each instance (row) stores only its non-zero feature values, 
+// ordered by feature index. Features that aren't stored are zero: a continuous_value of 
+// 0.0 or a discrete_value_index of 0.
+//
+struct ml_sparse_data {
+  // row r holds entries [row_offsets[r], row_offsets[r+1]) of feature_indices and values
+  ml_vector<std::size_t> row_offsets = {0};
+  ml_vector<ml_uint> feature_indices;
+  ml_vector<ml_feature_value> values;
+
+  std::size_t size() const { return(row_offsets.size() - 1); }
+  bool empty() const { return(size() == 0); }
+  void clear();
+
+  // append an instance from (feature index, value) entries in any order (zeros are dropped)
+  void add_instance(ml_vector<std::pair<ml_uint, ml_feature_value>> &entries);
+
+  // value of a feature for the instance at row (zero when it isn't stored)
+  ml_feature_value value(std::size_t row, ml_uint feature_index) const;
+
+  // dense copy of the instance at row with feature_count features
+  ml_instance instance(std::size_t row, std::size_t feature_count) const;
+};
+
+
+//
+// ml_prepared_data is a dataset prepared once for training many trees (forests, 
+// cross-validation folds, repeated experiments): each feature is stored as a column 
+// of small codes. Continuous values are quantized into up to max_bins bins by their
+// quantiles (value v is in bin k when bin_edges[k-1] <= v < bin_edges[k], missing 
+// values get the code after the last bin) and discrete features hold their 
+// discrete_value_index. Trees find splits from per bin totals of the rows of a node
+// instead of rescanning the instances. The instances are kept for evaluation.
+//
+struct ml_prepared_data {
+  ml_instance_definition mlid;
+  ml_data mld;
+  ml_vector<ml_vector<ml_float>> bin_edges; // per feature (continuous only)
+  ml_vector<ml_vector<uint16_t>> columns;   // per feature, one code per row
+
+  std::size_t size() const { return(mld.size()); }
+  bool empty() const { return(mld.empty()); }
+
+  // number of codes of a feature (for continuous features the bins and missing)
+  ml_uint codes(ml_uint feature_index) const;
+  ml_uint missing_code(ml_uint feature_index) const { return(bin_edges[feature_index].size() + 1); }
+};
+
+extern const ml_uint ML_DEFAULT_MAX_BINS;
+
+//
+// quantize mld (see ml_prepared_data). max_bins is at most 65534 and discrete 
+// features can have up to 65536 categories.
+//
+bool prepare_data(const ml_instance_definition &mlid, const ml_data &mld, 
+		  ml_prepared_data &mlpd, ml_uint max_bins = ML_DEFAULT_MAX_BINS);
+
+
+//
+// ml_load_options control how load_data() and load_data_using_instance_definition() 
+// read the input file. The file is split into chunks on line boundaries and the 
+// chunks are parsed in parallel.
+//
+struct ml_load_options {
+  // threads used to parse the file (0: one per available core)
+  ml_uint number_of_threads = 0;
+
+  // memory map the file and parse fields in place (false: read the file into memory)
+  bool memory_map = true;
+
+  // names of the columns to load (others are skipped as if marked :I in the instance 
+  // definition row). features keep the file's column order. empty: all columns not 
+  // marked :I are loaded
+  ml_vector<ml_string> columns;
+
+  // load_data() only: keep a binary copy of the loaded data next to the csv file 
+  // (<file>.pumlbin) and load from it while the csv size and modification time 
+  // are unchanged. see save_data_binary() below
+  bool use_binary_cache = false;
+
+  // keep missing values instead of filling them in with the feature's mean or mode 
+  // (and :P is ignored). missing continuous values are NaN and missing discrete values 
+  // are the unknown category (index 0). decision trees learn which side of a split 
+  // NaN values go to, and the data is loaded in a single pass
+  bool keep_missing = false;
+
+  // with keep_missing, the name of the feature to predict: its missing values are 
+  // filled in as without keep_missing (the feature's mean or mode, or :P) so that 
+  // no instance has a NaN or unknown target (trees don't train with NaN targets)
+  ml_string feature_to_predict;
+};
+
+
 //
 // load_data(...)
 //
 // path_to_input_file -- csv file where each row represents an instance, and the first row is in 
-//                       the instance definition format below.
+//                       the instance definition format below. gzip (and zstd, see PUML_ZSTD in
+//                       the Makefile) compressed files are decompressed while they're parsed.
 // ml_instance_definition -- will be populated with the features defined by the first row
 // ml_data -- will be populated with instance data from the csv
+// options -- threads used for parsing, etc (see ml_load_options above)
 // 
 // returns true on success
 //
@@ -187,7 +337,8 @@ using ml_data =  ml_vector<ml_instance_ptr>;
 // and a separate category for missing discrete features will be used. The 
 // default will use the feature's global mean or mode to populate missing values.
 //
-bool load_data(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld);
+bool load_data(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_data &mld,
+	       const ml_load_options &options = ml_load_options());
 
 
 //
@@ -203,7 +354,126 @@ bool load_data(const ml_string &path_to_input_file, ml_instance_definition &mlid
 // of test data from kaggle competition, etc).
 //
 bool load_data_using_instance_definition(const ml_string &path_to_input_file, const ml_instance_definition &mlid, 
-					 ml_data &mld, ml_vector<ml_string> *ids = nullptr);
+					 ml_data &mld, ml_vector<ml_string> *ids = nullptr,
+					 const ml_load_options &options = ml_load_options());
+
+
+//
+// load_libsvm_data(...)
+//
+// Loads a LIBSVM format file ("<label> <index>:<value> <index>:<value> ..." per line, with
+// 1-based feature indices) as sparse data. The label is feature 0 of the instance definition 
+// and LIBSVM feature i is feature i (named "i", continuous). label_type is continuous for 
+// regression or discrete for classification (labels become categories). qid:<n> tokens and 
+// # comments are skipped. Compressed files are read like load_data().
+//
+// If mlid isn't empty it's used as is (the instance definition of a model, for test data),
+// features beyond it are dropped. Otherwise it's populated from the file, where the mean/sd
+// of each feature includes its implicit zeros.
+//
+// returns true on success
+//
+bool load_libsvm_data(const ml_string &path_to_input_file, ml_instance_definition &mlid, ml_sparse_data &mlsd,
+		      ml_feature_type label_type = ml_feature_type::continuous);
+
+
+//
+// Save/Load Data To Disk (Binary)
+//
+// The binary format holds the instance definition (including discrete categories and
+// feature mean/sd) followed by the instance data stored column by column. Loading is
+// much faster than parsing csv since no text conversion is needed. Files are written
+// in native byte order and are rejected when read by an incompatible build.
+//
+// returns true on success
+//
+bool save_data_binary(const ml_string &path_to_file, const ml_instance_definition &mlid, const ml_data &mld);
+bool load_data_binary(const ml_string &path_to_file, ml_instance_definition &mlid, ml_data &mld);
+
+
+struct ml_stats_helper;
+class ml_line_reader;
+
+//
+// ml_data_reader streams the instances of a (compressed) csv or binary data file (see above) in 
+// chunks of at most instances_per_chunk instances, so data sets larger than memory
+// can be evaluated or trained on without loading them with load_data(). Only the
+// current chunk (and its text for csv files) is held in memory.
+//
+// Instances are converted using the given instance definition (mean/mode for missing
+// values, discrete category indices), typically the one a model was trained with. 
+// Categories not found in mlid are added to the reader's own copy (and its missing and 
+// category counts include the instances read, once however often they're read). When 
+// mlid is empty the definition is built from the file: the header of a binary file, or
+// an extra pass over a csv file.
+//
+// usage:
+//   ml_data_reader reader("big.csv", mlid);
+//   ml_data chunk;
+//   while(reader.read_chunk(chunk)) { ... }
+//
+class ml_data_reader final {
+ public:
+  static const ml_uint DEFAULT_INSTANCES_PER_CHUNK = 50000;
+
+  ml_data_reader(const ml_string &path_to_input_file, 
+		 const ml_instance_definition &mlid = ml_instance_definition(),
+		 ml_uint instances_per_chunk = DEFAULT_INSTANCES_PER_CHUNK,
+		 const ml_load_options &options = ml_load_options());
+
+  ~ml_data_reader();
+
+  ml_data_reader(const ml_data_reader &) = delete;
+  ml_data_reader &operator=(const ml_data_reader &) = delete;
+
+  // false if the file couldn't be opened or a chunk couldn't be parsed
+  bool good() const { return(status_); }
+
+  // replaces mld with the next chunk. returns false at the end of the data (or on error)
+  bool read_chunk(ml_data &mld);
+
+  // start again from the first instance
+  bool rewind();
+
+  // number of instances in the file (counted with a pass over the lines of a csv file)
+  uint64_t instance_count();
+
+  // index of the first instance of the next chunk
+  uint64_t position() const { return(position_); }
+
+  ml_uint instances_per_chunk() const { return(instances_per_chunk_); }
+  const ml_instance_definition &mlid() const { return(mlid_); }
+
+ private:
+  bool open(const ml_instance_definition &mlid);
+  bool open_csv(const ml_instance_definition &mlid);
+  bool open_binary(const ml_instance_definition &mlid);
+  bool read_csv_chunk(ml_data &mld, ml_vector<ml_stats_helper> &stats_helper);
+  bool read_binary_chunk(ml_data &mld);
+  bool scan_instance_definition();
+
+  ml_string path_;
+  ml_instance_definition mlid_;
+  ml_uint instances_per_chunk_;
+  ml_load_options options_;
+  std::unique_ptr<ml_line_reader> input_;
+  bool status_ = false;
+  bool binary_ = false;
+  uint64_t position_ = 0;
+  uint64_t instance_count_ = 0;
+  bool instance_count_known_ = false;
+
+  // csv
+  ml_vector<bool> ignored_columns_;
+  uint64_t data_begin_ = 0;
+  ml_uint header_lines_ = 0;
+  ml_uint line_number_ = 0;
+  ml_uint counted_lines_ = 0; // lines included in mlid_'s missing and category counts
+
+  // binary
+  uint64_t data_offset_ = 0;
+  ml_vector<ml_vector<ml_uint>> discrete_index_remap_;
+};
 
 
 //
@@ -215,6 +485,21 @@ void split_data_into_training_and_test(ml_data &mld, ml_float training_factor,
 				       ml_data &training, ml_data &test,
 				       ml_uint seed=ML_DEFAULT_SEED);
 
+//
+// the same split (the same instances for a seed) as views of mld, which isn't 
+// changed. the views share one permutation of the rows.
+//
+void split_data_into_training_and_test(const ml_data &mld, ml_float training_factor, 
+				       ml_data_view &training, ml_data_view &test,
+				       ml_uint seed=ML_DEFAULT_SEED);
+
+
+//
+// a random permutation of the rows 0..size-1 (the order shuffle_vector() gives
+// a vector of that size)
+//
+std::shared_ptr<const ml_vector<ml_uint>> shuffled_rows(std::size_t size, ml_rng &rng);
+
 
 //
 // Displays a summary of features including name, type, distribution, etc.
@@ -235,6 +520,15 @@ bool create_onehotencoding_for_data(const ml_instance_definition &mlid, const ml
 				    const ml_string &name_of_feature_to_predict, 
 				    ml_instance_definition &mlid_ohe, ml_data &mld_ohe);
 
+//
+// One Hot Encoding to sparse data: the same features as above (mlid_ohe), but each row only 
+// stores its non-zero values, one per discrete feature instead of one per category. Models
+// (decision_tree, random_forest) train and evaluate with the sparse data directly.
+//
+bool create_onehotencoding_for_data(const ml_instance_definition &mlid, const ml_data &mld, 
+				    const ml_string &name_of_feature_to_predict, 
+				    ml_instance_definition &mlid_ohe, ml_sparse_data &mlsd_ohe);
+
 
 //
 // Save/Read Instance Definition To Disk (JSON)
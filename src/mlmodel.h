@@ -5,6 +5,8 @@
 #include <utility>
 #include <vector>
 #include <functional>
+#include <thread>
+#include <algorithm>
 
 #include "mldata.h"
 #include "mlresults.h"
@@ -27,17 +29,89 @@ class ml_model final {
 				      ml_uint cvseed = ML_DEFAULT_SEED,
 				      custom_cv_func cv_func = nullptr);
 
+  //
+  // cross-validation with prepared data (see ml_prepared_data), the data is prepared
+  // once for all folds and each fold trains with its rows of the prepared data
+  //
+  template<typename U> 
+  ml_crossvalidation_results<U> train(const ml_prepared_data &mlpd, ml_uint folds = 10, 
+				      ml_uint cvseed = ML_DEFAULT_SEED,
+				      custom_cv_func cv_func = nullptr);
+
+  //
+  // out-of-bag estimate instead of cross-validation (for models with out-of-bag 
+  // predictions, e.g. random_forest): trains once on all of the data with out-of-bag 
+  // evaluation on and collects the out-of-bag prediction of each instance. Instances
+  // that were in the sample of every tree have no prediction and are skipped.
+  //
+  template<typename U>
+  U train_oob(const ml_data &mld) { return(train_oob<U>(ml_data_view(mld))); }
+
+  template<typename U>
+  U train_oob(const ml_data_view &mld);
+
+  template<typename U>
+  U train_oob(const ml_prepared_data &mlpd);
+
+  template<typename U>
+  U evaluate(const ml_data &mld) const { return(evaluate<U>(ml_data_view(mld))); }
+
+  template<typename U>
+  U evaluate(const ml_data_view &mld) const;
+
+  // evaluate data streamed with a reader (created with the model's instance definition),
+  // empty results if the data couldn't be read
   template<typename U>
-  U evaluate(const ml_data &mld) const;
+  U evaluate(ml_data_reader &reader) const;
+
+  // evaluate all rows of sparse data (for models trained with sparse data)
+  template<typename U>
+  U evaluate(const ml_sparse_data &mlsd) const;
 
   ml_feature_value evaluate(const ml_instance &instance) const { return(model_.evaluate(instance)); }
 
+  //
+  // thread budget for cross-validation: train() trains and evaluates as many folds 
+  // at once (each with its own copy of the model) as fit in threads, given the 
+  // threads the model uses itself (e.g. random_forest::number_of_threads()). Fold
+  // results are in fold order and the model ends up trained on the last fold, as 
+  // with sequential folds. cv_func is called in fold order from the calling thread.
+  // 0 or 1 (default) trains one fold at a time.
+  //
+  void set_cv_threads(ml_uint threads) { cv_threads_ = threads; }
+
+  //
+  // threads for evaluate(): the instances are split into as many contiguous parts,
+  // each part collects its own results and they're merged in order. 0 or 1 (default)
+  // evaluates in the calling thread. (Regression error sums are added per part, so 
+  // they can differ from a single thread in the last digits.)
+  //
+  void set_evaluate_threads(ml_uint threads) { evaluate_threads_ = threads; }
+
   ml_string summary() const { return(model_.summary()); }
 
   T &model() { return model_; }
   
  private:
   T model_;
+  ml_uint cv_threads_ = 0;
+  ml_uint evaluate_threads_ = 0;
+
+  ml_uint concurrent_folds(ml_uint folds) const;
+
+  template<typename U>
+  static U evaluate_model(const T &model, const ml_data_view &mld, ml_uint threads);
+
+  template<typename U>
+  static void collect_in_parts(std::size_t size, ml_uint threads, U &results, 
+			       const std::function<void (std::size_t begin, std::size_t end, U &part_results)> &collect);
+
+  template<typename U>
+  U out_of_bag_results(const ml_data_view &mld) const;
+
+  template<typename U> 
+  ml_crossvalidation_results<U> train_folds(const ml_data &mld, ml_uint folds, ml_uint cvseed, custom_cv_func cv_func,
+					    const std::function<void (T &model, const ml_data_view &training_fold)> &train_model);
 };
 
 } // namespace puml
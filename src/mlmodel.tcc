@@ -3,12 +3,91 @@
 
 namespace puml {
 
+//
+// the threads a model trains with: number_of_threads() for models that
+// have it, 1 otherwise
+//
+template<typename M>
+static auto model_threads(const M &model, int) -> decltype(ml_uint(model.number_of_threads())) {
+  return(std::max<ml_uint>(1, model.number_of_threads()));
+}
+
+template<typename M>
+static ml_uint model_threads(const M &, long) {
+  return(1);
+}
+
+
+//
+// views of a fold: the test rows are a contiguous range of the shuffled rows 
+// (order) and the training rows are the rest (all rows with a single fold)
+//
+inline void split_fold(const ml_data &mld, const std::shared_ptr<const ml_vector<ml_uint>> &order,
+		       ml_uint folds, ml_uint fold, ml_data_view &training_fold, ml_data_view &test_fold) {
+
+  using range = ml_data_view::ml_row_range;
+  std::size_t test_size = mld.size() / folds;
+  std::size_t test_offset = fold * test_size;
+  test_fold = ml_data_view(mld, order, {range(test_offset, test_offset + test_size)});
+
+  ml_vector<range> training_ranges;
+  if(fold > 0) {
+    training_ranges.push_back(range(0, test_offset));
+  }
+    
+  if(fold != (folds - 1)) {
+    training_ranges.push_back(range(test_offset + test_size, mld.size()));
+  }
+
+  training_fold = ml_data_view(mld, order, training_ranges);
+  if(training_fold.empty()) {
+    training_fold = ml_data_view(mld, order, {range(0, mld.size())});
+  }
+}
+
+
+template<typename T>
+ml_uint ml_model<T>::concurrent_folds(ml_uint folds) const {
+  ml_uint concurrent = cv_threads_ / model_threads(model_, 0);
+  return(std::max<ml_uint>(1, std::min(folds, concurrent)));
+}
+
+
 template<typename T>
 template<typename U> 
 ml_crossvalidation_results<U> ml_model<T>::train(const ml_data &mld, 
 			      			 ml_uint folds,
 						 ml_uint cvseed,
 				                 custom_cv_func cv_func) {
+  return(train_folds<U>(mld, folds, cvseed, cv_func, 
+			[](T &model, const ml_data_view &training_fold) { model.train(training_fold); }));
+}
+
+
+template<typename T>
+template<typename U> 
+ml_crossvalidation_results<U> ml_model<T>::train(const ml_prepared_data &mlpd, 
+			      			 ml_uint folds,
+						 ml_uint cvseed,
+				                 custom_cv_func cv_func) {
+  //
+  // the training rows of a fold are the rows of its view of the prepared instances
+  //
+  return(train_folds<U>(mlpd.mld, folds, cvseed, cv_func, 
+			[&mlpd](T &model, const ml_data_view &training_fold) {
+			  ml_vector<ml_uint> rows(training_fold.size());
+			  for(std::size_t ii = 0; ii < rows.size(); ++ii) {
+			    rows[ii] = training_fold.row(ii);
+			  }
+			  model.train(mlpd, rows);
+			}));
+}
+
+
+template<typename T>
+template<typename U> 
+ml_crossvalidation_results<U> ml_model<T>::train_folds(const ml_data &mld, ml_uint folds, ml_uint cvseed, custom_cv_func cv_func,
+						       const std::function<void (T &model, const ml_data_view &training_fold)> &train_model) {
 
   ml_crossvalidation_results<U> cv_results;
 
@@ -21,40 +100,69 @@ ml_crossvalidation_results<U> ml_model<T>::train(const ml_data &mld,
     return(cv_results);
   }
 
+  //
+  // the folds are views of one shuffled order of the rows
+  //
   ml_rng rng(cvseed);
-  ml_data mld_shuffle(mld);
-  shuffle_vector(mld_shuffle, rng);
+  auto order = shuffled_rows(mld.size(), rng);
 
   folds = (folds == 0) ? 1 : folds;
-  ml_uint test_size = mld_shuffle.size() / folds;
+  ml_uint concurrent = concurrent_folds(folds);
 
-  for(ml_uint fold = 0; fold < folds; ++fold) {
+  for(ml_uint first_fold = 0; first_fold < folds; first_fold += concurrent) {
 
-    log("\n *** %d fold cross-validation (fold %d) *** \n", folds, fold+1);
+    ml_uint wave = std::min(concurrent, folds - first_fold);
 
-    ml_uint test_offset = fold * test_size;
-    ml_data test_fold = ml_data(mld_shuffle.begin() + test_offset, mld_shuffle.begin() + test_offset + test_size);
+    if(wave == 1) {
+      log("\n *** %d fold cross-validation (fold %d) *** \n", folds, first_fold+1);
 
-    ml_data training_fold;
-    if(fold > 0) {
-      training_fold = ml_data(mld_shuffle.begin(), mld_shuffle.begin() + test_offset);
+      ml_data_view training_fold, test_fold;
+      split_fold(mld, order, folds, first_fold, training_fold, test_fold);
+
+      train_model(model_, training_fold);
+      U fold_results = evaluate<U>(test_fold);
+      if(cv_func) {
+	cv_func(model_, test_fold.to_data(), fold_results);
+      }
+      cv_results.add_fold_result(fold_results);
+      continue;
     }
-    
-    if(fold != (folds - 1)) {
-      training_fold.insert(training_fold.end(), mld_shuffle.begin() + test_offset + test_size, mld_shuffle.end());
+
+    //
+    // train and evaluate the folds of the wave at once, each with its own copy
+    // of the model (the first one in this thread)
+    //
+    ml_vector<T> fold_models(wave, model_);
+    ml_vector<ml_data_view> test_folds(wave);
+    ml_vector<U> fold_results(wave, U(model_.mlid(), model_.index_of_feature_to_predict()));
+
+    auto train_fold = [&](ml_uint ii) {
+      log("\n *** %d fold cross-validation (fold %d) *** \n", folds, first_fold+ii+1);
+      ml_data_view training_fold;
+      split_fold(mld, order, folds, first_fold + ii, training_fold, test_folds[ii]);
+      train_model(fold_models[ii], training_fold);
+      fold_results[ii] = evaluate_model<U>(fold_models[ii], test_folds[ii], 1);
+    };
+
+    ml_vector<std::thread> work_threads;
+    for(ml_uint ii = 1; ii < wave; ++ii) {
+      work_threads.emplace_back(std::thread(train_fold, ii));
     }
 
-    if(training_fold.empty()) {
-      training_fold = mld_shuffle;
+    train_fold(0);
+
+    for(auto &thread : work_threads) {
+      thread.join();
     }
 
-    model_.train(training_fold);
-    U fold_results = evaluate<U>(test_fold);
-    if(cv_func) {
-      cv_func(model_, test_fold, fold_results);
+    for(ml_uint ii = 0; ii < wave; ++ii) {
+      if(cv_func) {
+	cv_func(fold_models[ii], test_folds[ii].to_data(), fold_results[ii]);
+      }
+      cv_results.add_fold_result(fold_results[ii]);
     }
-    cv_results.add_fold_result(fold_results);
 
+    model_ = std::move(fold_models.back());
   }
 
   return(cv_results);
@@ -63,7 +171,131 @@ ml_crossvalidation_results<U> ml_model<T>::train(const ml_data &mld,
 
 template<typename T>
 template<typename U> 
-U ml_model<T>::evaluate(const ml_data &mld) const {
+U ml_model<T>::train_oob(const ml_data_view &mld) {
+
+  if(U::type() != model_.type()) {
+    log_error("model/results type mismatch\n");
+    return(U(model_.mlid(), model_.index_of_feature_to_predict()));
+  }
+
+  model_.set_evaluate_oob(true);
+  model_.train(mld);
+  return(out_of_bag_results<U>(mld));
+}
+
+
+template<typename T>
+template<typename U> 
+U ml_model<T>::train_oob(const ml_prepared_data &mlpd) {
+
+  if(U::type() != model_.type()) {
+    log_error("model/results type mismatch\n");
+    return(U(model_.mlid(), model_.index_of_feature_to_predict()));
+  }
+
+  model_.set_evaluate_oob(true);
+  model_.train(mlpd);
+  return(out_of_bag_results<U>(ml_data_view(mlpd.mld)));
+}
+
+
+//
+// the out-of-bag predictions of the model are in the order of mld (the training data) 
+//
+template<typename T>
+template<typename U> 
+U ml_model<T>::out_of_bag_results(const ml_data_view &mld) const {
+
+  U results(model_.mlid(), model_.index_of_feature_to_predict());
+
+  const ml_vector<ml_feature_value> &predictions = model_.oob_predictions();
+  const ml_vector<ml_uint> &counts = model_.oob_counts();
+  if((predictions.size() != mld.size()) || (counts.size() != mld.size())) {
+    log_warn("no out-of-bag predictions for the training data\n");
+    return(results);
+  }
+
+  for(std::size_t instance_index = 0; instance_index < mld.size(); ++instance_index) {
+    if(counts[instance_index] == 0) {
+      continue;
+    }
+    results.collect_result(predictions[instance_index], *mld[instance_index]);
+  }
+
+  return(results);
+}
+
+
+template<typename T>
+template<typename U> 
+U ml_model<T>::evaluate(const ml_data_view &mld) const {
+  return(evaluate_model<U>(model_, mld, evaluate_threads_));
+}
+
+
+template<typename T>
+template<typename U> 
+U ml_model<T>::evaluate_model(const T &model, const ml_data_view &mld, ml_uint threads) {
+
+  U results(model.mlid(), model.index_of_feature_to_predict());
+
+  if(U::type() != model.type()) {
+    log_error("model/results type mismatch\n");
+    return(results);
+  }
+
+  collect_in_parts<U>(mld.size(), threads, results, [&](std::size_t begin, std::size_t end, U &part_results) {
+      for(std::size_t instance_index = begin; instance_index < end; ++instance_index) {
+	const ml_instance_ptr &inst_ptr = mld[instance_index];
+	ml_feature_value result = model.evaluate(*inst_ptr);
+	part_results.collect_result(result, *inst_ptr);
+      }
+    });
+
+  return(results);
+}
+
+
+//
+// collect results for [0, size) in up to threads contiguous parts at once (the
+// first in this thread) and merge them into results (empty) in order
+//
+template<typename T>
+template<typename U> 
+void ml_model<T>::collect_in_parts(std::size_t size, ml_uint threads, U &results, 
+				   const std::function<void (std::size_t begin, std::size_t end, U &part_results)> &collect) {
+
+  std::size_t parts = std::min<std::size_t>(std::max<ml_uint>(1, threads), size);
+  if(parts <= 1) {
+    collect(0, size, results);
+    return;
+  }
+
+  ml_vector<U> part_results(parts, results);
+  auto collect_part = [&](std::size_t part) {
+    collect((size * part) / parts, (size * (part + 1)) / parts, part_results[part]);
+  };
+
+  ml_vector<std::thread> work_threads;
+  for(std::size_t part = 1; part < parts; ++part) {
+    work_threads.emplace_back(std::thread(collect_part, part));
+  }
+
+  collect_part(0);
+
+  for(auto &thread : work_threads) {
+    thread.join();
+  }
+
+  for(const U &part : part_results) {
+    results.merge(part);
+  }
+}
+
+
+template<typename T>
+template<typename U> 
+U ml_model<T>::evaluate(ml_data_reader &reader) const {
 
   U results(model_.mlid(), model_.index_of_feature_to_predict());
 
@@ -72,14 +304,63 @@ U ml_model<T>::evaluate(const ml_data &mld) const {
     return(results);
   }
 
-  for(const auto &inst_ptr : mld) {
-    ml_feature_value result = model_.evaluate(*inst_ptr);
-    results.collect_result(result, *inst_ptr);
+  if(!reader.rewind()) {
+    log_error("can't read data for evaluation\n");
+    return(results);
+  }
+
+  ml_data chunk;
+  while(reader.read_chunk(chunk)) {
+    U chunk_results(model_.mlid(), model_.index_of_feature_to_predict());
+    collect_in_parts<U>(chunk.size(), evaluate_threads_, chunk_results, [&](std::size_t begin, std::size_t end, U &part_results) {
+	for(std::size_t instance_index = begin; instance_index < end; ++instance_index) {
+	  const ml_instance_ptr &inst_ptr = chunk[instance_index];
+	  ml_feature_value result = model_.evaluate(*inst_ptr);
+	  part_results.collect_result(result, *inst_ptr);
+	}
+      });
+    results.merge(chunk_results);
+  }
+
+  //
+  // a chunk that couldn't be read ends the loop too, the results would be partial
+  //
+  if(!reader.good()) {
+    log_error("failed reading data for evaluation\n");
+    return(U(model_.mlid(), model_.index_of_feature_to_predict()));
   }
 
   return(results);
 }
 
 
+template<typename T>
+template<typename U> 
+U ml_model<T>::evaluate(const ml_sparse_data &mlsd) const {
+
+  U results(model_.mlid(), model_.index_of_feature_to_predict());
+
+  if(U::type() != model_.type()) {
+    log_error("model/results type mismatch\n");
+    return(results);
+  }
+
+  //
+  // results only look at the feature to predict of the instance
+  //
+  ml_uint index_of_feature_to_predict = model_.index_of_feature_to_predict();
+  collect_in_parts<U>(mlsd.size(), evaluate_threads_, results, [&](std::size_t begin, std::size_t end, U &part_results) {
+      ml_instance instance(index_of_feature_to_predict + 1);
+      for(std::size_t row = begin; row < end; ++row) {
+	ml_feature_value result = model_.evaluate(mlsd, row);
+	instance[index_of_feature_to_predict] = mlsd.value(row, index_of_feature_to_predict);
+	part_results.collect_result(result, instance);
+      }
+    });
+
+  return(results);
+}
+
+
 } // namespace puml
 
@@ -46,6 +46,14 @@ void ml_regression_results::collect_result(const ml_feature_value &prediction,
 }
 
 
+void ml_regression_results::merge(const ml_regression_results &other) {
+  sum_absolute_error_ += other.sum_absolute_error_;
+  sum_mean_squared_error_ += other.sum_mean_squared_error_;
+  sum_mean_squared_log_error_ += other.sum_mean_squared_log_error_;
+  instances_ += other.instances_;
+}
+
+
 ml_double ml_regression_results::mae_metric() const {
   ml_double mae = (instances_ > 0) ? (sum_absolute_error_ / instances_) : 0.0;
   return(mae);
@@ -93,7 +101,11 @@ ml_string ml_regression_results::summary() const {
 ml_classification_results::ml_classification_results(const ml_instance_definition &mlid,
 						     ml_uint index_of_feature_to_predict) :
   ml_results(mlid, index_of_feature_to_predict) {
-  
+
+  if((index_of_feature_to_predict_ < mlid_.size()) && (mlid_[index_of_feature_to_predict_]->type == ml_feature_type::discrete)) {
+    categories_ = mlid_[index_of_feature_to_predict_]->discrete_values.size();
+  }
+  confusion_matrix_.assign(categories_ * categories_, 0);
 }
 
 
@@ -102,8 +114,9 @@ void ml_classification_results::collect_result(const ml_feature_value &predictio
 					 
    ml_uint model = prediction.discrete_value_index;
    ml_uint actual = instance[index_of_feature_to_predict_].discrete_value_index;
-   ml_string key = std::to_string(actual) + "-" + std::to_string(model);
-   confusion_matrix_map_[key] += 1;
+   if((actual < categories_) && (model < categories_)) {
+     confusion_matrix_[(actual * categories_) + model] += 1;
+   }
    ++instances_;
    if(model == actual) {
      ++instances_correctly_classified_;
@@ -111,6 +124,50 @@ void ml_classification_results::collect_result(const ml_feature_value &predictio
 }
 
 
+ml_uint ml_classification_results::confusion_count(ml_uint actual, ml_uint predicted) const {
+  return(((actual < categories_) && (predicted < categories_)) ? confusion_matrix_[(actual * categories_) + predicted] : 0);
+}
+
+
+ml_double ml_classification_results::precision(ml_uint category) const {
+  ml_uint predicted = 0;
+  for(ml_uint actual = 0; actual < categories_; ++actual) {
+    predicted += confusion_count(actual, category);
+  }
+  return((predicted > 0) ? ((ml_double) confusion_count(category, category) / predicted) : 0.0);
+}
+
+
+ml_double ml_classification_results::recall(ml_uint category) const {
+  ml_uint actual = 0;
+  for(ml_uint predicted = 0; predicted < categories_; ++predicted) {
+    actual += confusion_count(category, predicted);
+  }
+  return((actual > 0) ? ((ml_double) confusion_count(category, category) / actual) : 0.0);
+}
+
+
+ml_double ml_classification_results::f1(ml_uint category) const {
+  ml_double p = precision(category);
+  ml_double r = recall(category);
+  return(((p + r) > 0.0) ? ((2.0 * p * r) / (p + r)) : 0.0);
+}
+
+
+void ml_classification_results::merge(const ml_classification_results &other) {
+  if(other.categories_ != categories_) {
+    log_error("can't merge classification results with %u categories into results with %u\n", other.categories_, categories_);
+    return;
+  }
+
+  for(std::size_t ii = 0; ii < confusion_matrix_.size(); ++ii) {
+    confusion_matrix_[ii] += other.confusion_matrix_[ii];
+  }
+  instances_correctly_classified_ += other.instances_correctly_classified_;
+  instances_ += other.instances_;
+}
+
+
 ml_double ml_classification_results::accuracy_metric() const {
   ml_float pct = (instances_ > 0) ? ((ml_float) instances_correctly_classified_ / instances_) * 100.0 : 0.0;
   return(pct);
@@ -161,20 +218,17 @@ ml_string ml_classification_results::summary() const {
 
   for(std::size_t ii=1; ii < mlid_[index_of_feature_to_predict_]->discrete_values.size(); ++ii) {
     for(std::size_t jj=1; jj < mlid_[index_of_feature_to_predict_]->discrete_values.size(); ++jj) {
-      
-      ml_string key = std::to_string(ii) + "-" + std::to_string(jj);
-      ml_uint count = 0;
-      ml_map<ml_string, ml_uint>::const_iterator it = confusion_matrix_map_.find(key);
-      if(it != confusion_matrix_map_.end()) {
-	count = it->second;
-      }
-
-      desc += string_format("%7d", count);
+      desc += string_format("%7d", confusion_count(ii, jj));
     }
     
     desc += string_format(" | %c = %s\n", ((char)(ii-1)) + 'a', mlid_[index_of_feature_to_predict_]->discrete_values[ii].c_str());
   }
 
+  desc += "\n  precision  recall     f1\n";
+  for(std::size_t ii=1; ii < mlid_[index_of_feature_to_predict_]->discrete_values.size(); ++ii) {
+    desc += string_format("%11.3f %7.3f %7.3f | %c\n", precision(ii), recall(ii), f1(ii), ((char)(ii-1)) + 'a');
+  }
+
   desc += "\n";
 
   return(desc);
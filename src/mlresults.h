@@ -53,6 +53,9 @@ class ml_regression_results final : public ml_results {
 
   static ml_model_type type() { return(ml_model_type::regression); }
 
+  // add the results collected by other (e.g. for another part of the same data)
+  void merge(const ml_regression_results &other);
+
   ml_double value_for_metric(ml_regression_metric metric) const;
   ml_string summary() const;
 
@@ -82,16 +85,33 @@ class ml_classification_results final : public ml_results {
 
   static ml_model_type type() { return(ml_model_type::classification); }
 
+  // add the results collected by other (e.g. for another part of the same data),
+  // results for a different number of categories aren't merged (logs an error)
+  void merge(const ml_classification_results &other);
+
   ml_double value_for_metric(ml_classification_metric metric) const;
   ml_string summary() const;
 
+  //
+  // the confusion matrix and per class metrics (in [0,1], 0 for a class without
+  // predictions or instances), categories are discrete value indexes of the
+  // feature to predict
+  //
+  ml_uint confusion_count(ml_uint actual, ml_uint predicted) const;
+  ml_double precision(ml_uint category) const;
+  ml_double recall(ml_uint category) const;
+  ml_double f1(ml_uint category) const;
+
 
  private:
 
   ml_double accuracy_metric() const;
 
   ml_uint instances_correctly_classified_ = 0;
-  ml_map<ml_string, ml_uint> confusion_matrix_map_;
+
+  // categories x categories counts, row is the actual category and column the predicted one
+  ml_uint categories_ = 0;
+  ml_vector<ml_uint> confusion_matrix_;
 
 };
 
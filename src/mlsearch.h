@@ -0,0 +1,154 @@
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#include "mlmodel.h"
+#include "randomforest.h"
+
+namespace puml {
+
+//
+// one random forest configuration of a search
+//
+struct rf_hyperparameters {
+  ml_uint number_of_trees = 0;
+  ml_uint max_tree_depth = random_forest::RF_DEFAULT_DEPTH;
+  ml_uint min_leaf_instances = random_forest::RF_DEFAULT_MININST;
+  ml_uint features_to_consider_per_node = random_forest::RF_DEFAULT_FEATURES_SQRT;
+
+  ml_string summary() const {
+    ml_string features = (features_to_consider_per_node == random_forest::RF_DEFAULT_FEATURES_SQRT) ?
+      "sqrt" : std::to_string(features_to_consider_per_node);
+    return("trees: " + std::to_string(number_of_trees) + ", max depth: " + std::to_string(max_tree_depth) +
+	   ", min leaf instances: " + std::to_string(min_leaf_instances) +
+	   ", features per node: " + features);
+  }
+};
+
+
+//
+// the metric a search ranks trials by (accuracy, higher is better, for classification
+// and rmse, lower is better, for regression by default)
+//
+template<typename U>
+struct ml_search_metric;
+
+template<>
+struct ml_search_metric<ml_classification_results> {
+  using type = ml_classification_metric;
+  static type default_metric() { return(ml_classification_metric::accuracy); }
+  static bool better(ml_double value, ml_double other) { return(value > other); }
+};
+
+template<>
+struct ml_search_metric<ml_regression_results> {
+  using type = ml_regression_metric;
+  static type default_metric() { return(ml_regression_metric::rmse); }
+  static bool better(ml_double value, ml_double other) { return(value < other); }
+};
+
+
+//
+// a trial of a search: its configuration, the results of the folds it was evaluated
+// on (all folds unless successive halving dropped it) and its average for the metric
+//
+template<typename U>
+struct ml_search_trial {
+  rf_hyperparameters hyperparameters;
+  ml_crossvalidation_results<U> cv_results;
+  ml_double metric = 0.0;
+};
+
+
+//
+// Grid / random search over random forest hyperparameters with cross-validation on
+// prepared data (see ml_prepared_data). The data is prepared once and every trial
+// trains with the rows of its folds, the folds are those of ml_model::train() with
+// the same folds and cvseed. The grid is every combination of the values set for
+// each hyperparameter (the random_forest defaults if none are set), random search
+// evaluates a sample of it.
+//
+// Successive halving: trials are evaluated in rungs, the first rung evaluates every
+// trial on one fold and each following rung keeps the best 1/eta of the trials and
+// evaluates them on eta times as many folds, until the survivors have seen all folds.
+// The folds of a trial's earlier rungs are kept, so a trial is never trained on the
+// same fold twice.
+//
+// Trials are trained on a pool of threads (one forest per thread, each forest trains
+// single threaded), every fold of every trial of a rung is a task of the pool. Results
+// don't depend on the number of threads.
+//
+template<typename U>
+class random_forest_search final {
+
+ public:
+
+  using metric_type = typename ml_search_metric<U>::type;
+
+  random_forest_search(const ml_prepared_data &mlpd,
+		       const ml_string &feature_to_predict,
+		       ml_uint folds = 5,
+		       ml_uint cvseed = ML_DEFAULT_SEED);
+
+  //
+  // the values to search for each hyperparameter
+  //
+  void set_number_of_trees(const ml_vector<ml_uint> &values) { number_of_trees_ = values; }
+  void set_max_tree_depth(const ml_vector<ml_uint> &values) { max_tree_depth_ = values; }
+  void set_min_leaf_instances(const ml_vector<ml_uint> &values) { min_leaf_instances_ = values; }
+  void set_features_to_consider_per_node(const ml_vector<ml_uint> &values) { features_to_consider_per_node_ = values; }
+
+  //
+  // random search: evaluate trials configurations drawn (without repeats) from the
+  // grid with seed. 0 (default) evaluates the whole grid.
+  //
+  void set_random_trials(ml_uint trials, ml_uint seed = ML_DEFAULT_SEED) { random_trials_ = trials; random_seed_ = seed; }
+
+  //
+  // successive halving with a reduction factor of eta (see above). 0 or 1 (default)
+  // evaluates every trial on all folds.
+  //
+  void set_successive_halving(ml_uint eta) { eta_ = eta; }
+
+  void set_threads(ml_uint threads) { threads_ = threads; }
+  void set_metric(metric_type metric) { metric_ = metric; }
+
+  // the seed of the forests of all trials
+  void set_seed(ml_uint seed) { seed_ = seed; }
+
+  //
+  // run the search, the trials are ordered best first: by the number of folds they
+  // were evaluated on (the survivors of successive halving first) and then by metric
+  //
+  ml_vector<ml_search_trial<U>> run() const;
+
+ private:
+
+  const ml_prepared_data &mlpd_;
+  ml_string feature_to_predict_;
+  ml_uint folds_ = 5;
+  ml_uint cvseed_ = ML_DEFAULT_SEED;
+  ml_uint seed_ = ML_DEFAULT_SEED;
+  ml_uint threads_ = random_forest::RF_DEFAULT_THREADS;
+  ml_uint eta_ = 0;
+  ml_uint random_trials_ = 0;
+  ml_uint random_seed_ = ML_DEFAULT_SEED;
+  metric_type metric_ = ml_search_metric<U>::default_metric();
+
+  ml_vector<ml_uint> number_of_trees_ = {100};
+  ml_vector<ml_uint> max_tree_depth_ = {random_forest::RF_DEFAULT_DEPTH};
+  ml_vector<ml_uint> min_leaf_instances_ = {random_forest::RF_DEFAULT_MININST};
+  ml_vector<ml_uint> features_to_consider_per_node_ = {random_forest::RF_DEFAULT_FEATURES_SQRT};
+
+  ml_vector<rf_hyperparameters> trial_hyperparameters() const;
+  U evaluate_fold(const rf_hyperparameters &hyperparameters, const std::shared_ptr<const ml_vector<ml_uint>> &order, ml_uint fold) const;
+};
+
+} // namespace puml
+
+#include "mlsearch.tcc"
@@ -0,0 +1,186 @@
+
+#pragma once
+
+namespace puml {
+
+template<typename U>
+random_forest_search<U>::random_forest_search(const ml_prepared_data &mlpd,
+					      const ml_string &feature_to_predict,
+					      ml_uint folds,
+					      ml_uint cvseed) :
+  mlpd_(mlpd),
+  feature_to_predict_(feature_to_predict),
+  folds_((folds == 0) ? 1 : folds),
+  cvseed_(cvseed) {
+}
+
+
+template<typename U>
+ml_vector<rf_hyperparameters> random_forest_search<U>::trial_hyperparameters() const {
+
+  ml_vector<rf_hyperparameters> grid;
+  for(ml_uint trees : number_of_trees_) {
+    for(ml_uint depth : max_tree_depth_) {
+      for(ml_uint min_leaf : min_leaf_instances_) {
+	for(ml_uint features : features_to_consider_per_node_) {
+	  rf_hyperparameters hyperparameters;
+	  hyperparameters.number_of_trees = trees;
+	  hyperparameters.max_tree_depth = depth;
+	  hyperparameters.min_leaf_instances = min_leaf;
+	  hyperparameters.features_to_consider_per_node = features;
+	  grid.push_back(hyperparameters);
+	}
+      }
+    }
+  }
+
+  if((random_trials_ == 0) || (random_trials_ >= grid.size())) {
+    return(grid);
+  }
+
+  ml_rng rng(random_seed_);
+  shuffle_vector(grid, rng);
+  grid.resize(random_trials_);
+  return(grid);
+}
+
+
+template<typename U>
+U random_forest_search<U>::evaluate_fold(const rf_hyperparameters &hyperparameters,
+					 const std::shared_ptr<const ml_vector<ml_uint>> &order, ml_uint fold) const {
+
+  ml_data_view training_fold, test_fold;
+  split_fold(mlpd_.mld, order, folds_, fold, training_fold, test_fold);
+
+  ml_vector<ml_uint> rows(training_fold.size());
+  for(std::size_t ii = 0; ii < rows.size(); ++ii) {
+    rows[ii] = training_fold.row(ii);
+  }
+
+  ml_model<random_forest> model(mlpd_.mlid, feature_to_predict_, hyperparameters.number_of_trees, seed_, 1,
+				hyperparameters.max_tree_depth, hyperparameters.min_leaf_instances,
+				hyperparameters.features_to_consider_per_node);
+  model.model().train(mlpd_, rows);
+  return(model.evaluate<U>(test_fold));
+}
+
+
+template<typename U>
+ml_vector<ml_search_trial<U>> random_forest_search<U>::run() const {
+
+  ml_vector<ml_search_trial<U>> trials;
+
+  if(mlpd_.empty()) {
+    log_error("search run() empty prepared data...\n");
+    return(trials);
+  }
+
+  ml_uint index_of_feature_to_predict = index_of_feature_with_name(feature_to_predict_, mlpd_.mlid);
+  ml_model_type type = (mlpd_.mlid[index_of_feature_to_predict]->type == ml_feature_type::discrete) ?
+    ml_model_type::classification : ml_model_type::regression;
+  if(U::type() != type) {
+    log_error("model/results type mismatch\n");
+    return(trials);
+  }
+
+  ml_vector<rf_hyperparameters> hyperparameters = trial_hyperparameters();
+  ml_vector<ml_vector<U>> fold_results(hyperparameters.size());
+  ml_vector<ml_double> metrics(hyperparameters.size(), 0.0);
+  U no_results(mlpd_.mlid, index_of_feature_to_predict);
+
+  ml_rng rng(cvseed_);
+  auto order = shuffled_rows(mlpd_.size(), rng);
+
+  //
+  // the trials still in the search, the best first after each rung
+  //
+  ml_vector<ml_uint> active(hyperparameters.size());
+  for(ml_uint ii = 0; ii < active.size(); ++ii) {
+    active[ii] = ii;
+  }
+
+  bool halving = (eta_ > 1);
+  ml_uint rung_folds = halving ? 1 : folds_;
+  ml_uint folds_evaluated = 0;
+
+  for(ml_uint rung = 1; !active.empty(); ++rung) {
+
+    rung_folds = std::min(rung_folds, folds_);
+    log("\n *** search rung %d: %d trials on %d of %d folds *** \n", rung, (ml_uint) active.size(), rung_folds, folds_);
+
+    //
+    // a task per trial and fold not evaluated yet, taken by the threads of the
+    // pool (and this one) in order
+    //
+    ml_vector<std::pair<ml_uint, ml_uint>> tasks;
+    for(ml_uint trial : active) {
+      fold_results[trial].resize(rung_folds, no_results);
+      for(ml_uint fold = folds_evaluated; fold < rung_folds; ++fold) {
+	tasks.push_back(std::make_pair(trial, fold));
+      }
+    }
+
+    std::atomic<std::size_t> next_task(0);
+    auto run_tasks = [&]() {
+      for(std::size_t task = next_task++; task < tasks.size(); task = next_task++) {
+	ml_uint trial = tasks[task].first;
+	ml_uint fold = tasks[task].second;
+	fold_results[trial][fold] = evaluate_fold(hyperparameters[trial], order, fold);
+      }
+    };
+
+    std::size_t pool_size = std::min<std::size_t>(std::max<ml_uint>(1, threads_), tasks.size());
+    ml_vector<std::thread> work_threads;
+    for(std::size_t ii = 1; ii < pool_size; ++ii) {
+      work_threads.emplace_back(std::thread(run_tasks));
+    }
+
+    run_tasks();
+
+    for(auto &thread : work_threads) {
+      thread.join();
+    }
+
+    for(ml_uint trial : active) {
+      ml_double sum = 0.0;
+      for(const U &results : fold_results[trial]) {
+	sum += results.value_for_metric(metric_);
+      }
+      metrics[trial] = sum / rung_folds;
+    }
+
+    std::stable_sort(active.begin(), active.end(), [&](ml_uint trial, ml_uint other) {
+	return(ml_search_metric<U>::better(metrics[trial], metrics[other]));
+      });
+
+    folds_evaluated = rung_folds;
+    if(folds_evaluated == folds_) {
+      break;
+    }
+
+    active.resize(std::max<std::size_t>(1, active.size() / eta_));
+    rung_folds *= eta_;
+  }
+
+  for(ml_uint trial = 0; trial < hyperparameters.size(); ++trial) {
+    ml_search_trial<U> search_trial;
+    search_trial.hyperparameters = hyperparameters[trial];
+    search_trial.metric = metrics[trial];
+    for(const U &results : fold_results[trial]) {
+      search_trial.cv_results.add_fold_result(results);
+    }
+    trials.push_back(search_trial);
+  }
+
+  std::stable_sort(trials.begin(), trials.end(), [](const ml_search_trial<U> &trial, const ml_search_trial<U> &other) {
+      if(trial.cv_results.folds() != other.cv_results.folds()) {
+	return(trial.cv_results.folds() > other.cv_results.folds());
+      }
+      return(ml_search_metric<U>::better(trial.metric, other.metric));
+    });
+
+  return(trials);
+}
+
+
+} // namespace puml
@@ -21,19 +21,29 @@ SOFTWARE.
 */
 
 #include <iostream>
+#include <fstream>
+#include <cstdio>
 
 #include "mlmodel.h"
 #include "decisiontree.h"
 #include "randomforest.h"
+#include "gradientboosting.h"
 
 
 void decision_tree_example();
 void random_forest_example();
+void gradient_boosting_example();
+bool keep_missing_load_test();
 
 int main(int argc, char **argv) {
 
+  if(!keep_missing_load_test()) {
+    return 1;
+  }
+
   decision_tree_example();
   random_forest_example();
+  gradient_boosting_example();
  
   return 0;
 }
@@ -97,3 +107,58 @@ void random_forest_example() {
 }
 
 
+void gradient_boosting_example() {
+
+  std::cout << "+++ gradient boosting demo using iris data +++" << std::endl;
+
+  // Load the Iris data
+  puml::ml_data mld;
+  puml::ml_instance_definition mlid;
+  puml::load_data("./iris.csv", mlid, mld);
+
+  // Take 50% for training
+  puml::ml_data training, test;
+  puml::split_data_into_training_and_test(mld, 0.5, training, test, 999);
+
+  // 5 fold cross validation, 50 boosting rounds of depth 3 trees 
+  // with a learning rate of 0.1
+  puml::ml_model<puml::gradient_boosting> gb{mlid, "Class", 50, 0.1, 3};
+  auto cv = gb.train<puml::ml_classification_results>(training, 5, 333);
+  std::cout << cv.summary() << std::endl;
+  std::cout << "testing using holdout..." << std::endl;
+  auto test_results = gb.evaluate<puml::ml_classification_results>(test);
+  std::cout << "*** Holdout Results ***" << std::endl << test_results.summary();
+
+}
+
+
+bool keep_missing_load_test() {
+
+  std::cout << "+++ keep missing load test +++" << std::endl;
+
+  // missing categories (empty and ?) must load as the unknown category
+  const char *path = "./keep_missing_test.csv";
+  {
+    std::ofstream out(path);
+    out << "c:D,x:C,y:C\n" << "red,1,1\n" << ",2,2\n" << "blue,3,3\n" << "?,4,4\n";
+  }
+
+  puml::ml_load_options options;
+  options.keep_missing = true;
+  options.feature_to_predict = "y";
+
+  puml::ml_data mld;
+  puml::ml_instance_definition mlid;
+  bool loaded = puml::load_data(path, mlid, mld, options);
+  std::remove(path);
+
+  const puml::ml_vector<puml::ml_string> expected = {"red", puml::ML_UNKNOWN_DISCRETE_CATEGORY, 
+						     "blue", puml::ML_UNKNOWN_DISCRETE_CATEGORY};
+  bool passed = loaded && (mld.size() == expected.size());
+  for(std::size_t ii = 0; passed && (ii < mld.size()); ++ii) {
+    passed = (mlid[0]->discrete_values[(*mld[ii])[0].discrete_value_index] == expected[ii]);
+  }
+
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return(passed);
+}
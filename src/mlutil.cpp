@@ -25,8 +25,17 @@ SOFTWARE.
 
 #include <ctime>
 #include <dirent.h>
+#include <fcntl.h>
 #include <sstream>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#ifdef PUML_ZSTD
+#include <zstd.h>
+#endif
 
 namespace puml {
 
@@ -173,4 +182,293 @@ bool get_modeltype_value_from_json(const json &json_object, const ml_string &nam
   return(status);
 }
 
+
+bool ml_mapped_file::open(const ml_string &path) {
+
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return(false);
+  }
+
+  struct stat info;
+  if((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode) || (info.st_size <= 0)) {
+    ::close(fd);
+    return(false);
+  }
+
+  void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(mapping == MAP_FAILED) {
+    return(false);
+  }
+
+  madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+  data_ = (const char *) mapping;
+  size_ = info.st_size;
+
+  return(true);
+}
+
+
+void ml_mapped_file::close() {
+  if(data_) {
+    munmap((void *) data_, size_);
+  }
+
+  data_ = nullptr;
+  size_ = 0;
+}
+
+static const std::size_t ML_DECOMPRESS_BLOCK_BYTES = 1 << 20;
+static const std::size_t ML_DECOMPRESS_MAX_BLOCKS = 8;
+
+
+ml_file_reader::format ml_file_reader::format_of_file(const ml_string &path) {
+
+  unsigned char magic[4] = {};
+  FILE *file = fopen(path.c_str(), "rb");
+  std::size_t size = file ? fread(magic, 1, sizeof(magic), file) : 0;
+  if(file) {
+    fclose(file);
+  }
+
+  if((size >= 2) && (magic[0] == 0x1f) && (magic[1] == 0x8b)) {
+    return(format::gzip);
+  }
+
+  if((size == 4) && (magic[0] == 0x28) && (magic[1] == 0xb5) && (magic[2] == 0x2f) && (magic[3] == 0xfd)) {
+    return(format::zstd);
+  }
+
+  return(format::plain);
+}
+
+
+bool ml_file_reader::is_compressed(const ml_string &path) {
+  return(format_of_file(path) != format::plain);
+}
+
+
+bool ml_file_reader::open(const ml_string &path) {
+
+  close();
+
+  path_ = path;
+  format_ = format_of_file(path);
+
+  if(format_ == format::plain) {
+    file_ = fopen(path.c_str(), "rb");
+    return(file_ != nullptr);
+  }
+
+#ifndef PUML_ZSTD
+  if(format_ == format::zstd) {
+    log_error("%s is zstd compressed, build with PUML_ZSTD to read it\n", path.c_str());
+    return(false);
+  }
+#endif
+
+  if(access(path.c_str(), R_OK) != 0) {
+    return(false);
+  }
+
+  done_ = false;
+  stop_ = false;
+  failed_ = false;
+  thread_ = std::thread([this] { decompress(); });
+
+  return(true);
+}
+
+
+void ml_file_reader::close() {
+
+  if(thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  if(file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+
+  blocks_.clear();
+  block_.clear();
+  block_pos_ = 0;
+}
+
+
+bool ml_file_reader::failed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return(failed_);
+}
+
+
+std::size_t ml_file_reader::read(char *buffer, std::size_t size) {
+
+  if(format_ == format::plain) {
+    return(file_ ? fread(buffer, 1, size, file_) : 0);
+  }
+
+  std::size_t bytes_read = 0;
+  while(bytes_read < size) {
+
+    if(block_pos_ == block_.size()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return(!blocks_.empty() || done_); });
+      if(blocks_.empty()) {
+	break;
+      }
+
+      block_.swap(blocks_.front());
+      blocks_.pop_front();
+      block_pos_ = 0;
+      cv_.notify_all();
+    }
+
+    std::size_t bytes = std::min(size - bytes_read, block_.size() - block_pos_);
+    memcpy(buffer + bytes_read, block_.data() + block_pos_, bytes);
+    block_pos_ += bytes;
+    bytes_read += bytes;
+  }
+
+  return(bytes_read);
+}
+
+
+bool ml_file_reader::seek(uint64_t offset) {
+
+  if(format_ == format::plain) {
+    return(file_ && (fseeko(file_, offset, SEEK_SET) == 0));
+  }
+
+  if(!open(path_)) {
+    return(false);
+  }
+
+  ml_string discard(ML_DECOMPRESS_BLOCK_BYTES, '\0');
+  while(offset > 0) {
+    std::size_t bytes = read(&discard[0], std::min<uint64_t>(offset, discard.size()));
+    if(bytes == 0) {
+      return(false);
+    }
+    offset -= bytes;
+  }
+
+  return(true);
+}
+
+
+void ml_file_reader::decompress() {
+
+  //
+  // runs on thread_. decompressed blocks are queued for read(), blocking
+  // while ML_DECOMPRESS_MAX_BLOCKS are waiting
+  //
+  auto queue_block = [this](ml_string &block) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return((blocks_.size() < ML_DECOMPRESS_MAX_BLOCKS) || stop_); });
+    if(stop_) {
+      return(false);
+    }
+
+    blocks_.push_back(ml_string());
+    blocks_.back().swap(block);
+    cv_.notify_all();
+    return(true);
+  };
+
+  bool failed = false;
+
+  if(format_ == format::gzip) {
+    gzFile gz = gzopen(path_.c_str(), "rb");
+    failed = (gz == nullptr);
+    if(gz) {
+      gzbuffer(gz, 128 * 1024);
+      while(true) {
+	ml_string block(ML_DECOMPRESS_BLOCK_BYTES, '\0');
+	int bytes = gzread(gz, &block[0], block.size());
+	if(bytes <= 0) {
+	  //
+	  // a truncated file also reads 0 bytes, only gzerror() tells it from the end
+	  //
+	  int error = Z_OK;
+	  gzerror(gz, &error);
+	  failed = (bytes < 0) || (error != Z_OK);
+	  break;
+	}
+
+	block.resize(bytes);
+	if(!queue_block(block)) {
+	  break;
+	}
+      }
+      gzclose(gz);
+    }
+  }
+#ifdef PUML_ZSTD
+  else if(format_ == format::zstd) {
+    FILE *file = fopen(path_.c_str(), "rb");
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    failed = (file == nullptr) || (dctx == nullptr);
+
+    ml_string input_block(ZSTD_DStreamInSize(), '\0');
+    std::size_t ret = 0;
+    bool stopped = false;
+    while(!failed && !stopped) {
+      std::size_t input_bytes = fread(&input_block[0], 1, input_block.size(), file);
+      if(input_bytes == 0) {
+	// the last frame is incomplete unless the decoder finished it
+	failed = ferror(file) || (ret != 0);
+	break;
+      }
+
+      //
+      // a full output block may leave more output in the decoder, so decompress until
+      // the input is consumed and the output isn't full
+      //
+      ZSTD_inBuffer input = { input_block.data(), input_bytes, 0 };
+      bool flushed = false;
+      while(!flushed) {
+	ml_string block(ML_DECOMPRESS_BLOCK_BYTES, '\0');
+	ZSTD_outBuffer output = { &block[0], block.size(), 0 };
+	ret = ZSTD_decompressStream(dctx, &output, &input);
+	if(ZSTD_isError(ret)) {
+	  failed = true;
+	  break;
+	}
+
+	flushed = (input.pos == input.size) && (output.pos < output.size);
+	block.resize(output.pos);
+	if(!block.empty() && !queue_block(block)) {
+	  stopped = true;
+	  break;
+	}
+      }
+    }
+
+    ZSTD_freeDCtx(dctx);
+    if(file) {
+      fclose(file);
+    }
+  }
+#endif
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(failed && !stop_) {
+    log_error("failed decompressing %s\n", path_.c_str());
+  }
+  failed_ = failed;
+  done_ = true;
+  cv_.notify_all();
+}
+
 } // namespace puml
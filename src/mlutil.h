@@ -22,6 +22,12 @@ SOFTWARE.
 
 #pragma once
 
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "mldata.h"
 
 
@@ -47,6 +53,80 @@ namespace puml {
   bool get_modeltype_value_from_json(const json &json_object, const ml_string &name, ml_model_type &value);
 
 
+  //
+  // Read-only memory mapping of a file
+  //
+  class ml_mapped_file final {
+  public:
+    ml_mapped_file() {}
+    ~ml_mapped_file() { close(); }
+
+    ml_mapped_file(const ml_mapped_file &) = delete;
+    ml_mapped_file &operator=(const ml_mapped_file &) = delete;
+
+    bool open(const ml_string &path);
+    void close();
+
+    const char *data() const { return(data_); }
+    std::size_t size() const { return(size_); }
+
+  private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+  };
+
+
+  //
+  // Sequential reads of a plain or compressed file. gzip files and zstd files (when 
+  // built with PUML_ZSTD) are recognized by their magic bytes and decompressed on a 
+  // separate thread that stays a few blocks ahead of read().
+  //
+  class ml_file_reader final {
+  public:
+    ml_file_reader() {}
+    ~ml_file_reader() { close(); }
+
+    ml_file_reader(const ml_file_reader &) = delete;
+    ml_file_reader &operator=(const ml_file_reader &) = delete;
+
+    bool open(const ml_string &path);
+    void close();
+
+    // returns the number of bytes read (0 at the end of the file or on error)
+    std::size_t read(char *buffer, std::size_t size);
+
+    // offset into the (decompressed) file. compressed files are decompressed again 
+    // from the start
+    bool seek(uint64_t offset);
+
+    bool compressed() const { return(format_ != format::plain); }
+    bool failed() const;
+
+    static bool is_compressed(const ml_string &path);
+
+  private:
+    enum class format { plain, gzip, zstd };
+
+    static format format_of_file(const ml_string &path);
+    void decompress();
+
+    ml_string path_;
+    format format_ = format::plain;
+    FILE *file_ = nullptr;
+
+    // decompression
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<ml_string> blocks_;
+    ml_string block_;
+    std::size_t block_pos_ = 0;
+    bool done_ = false;
+    bool stop_ = false;
+    bool failed_ = false;
+  };
+
+
   //
   // sprintf for string
   //
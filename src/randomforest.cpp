@@ -24,8 +24,11 @@ SOFTWARE.
 #include <fstream>
 #include <iomanip>
 #include <algorithm>
+#include <limits>
 #include <thread>
+#include <chrono>
 #include <string.h>
+#include <stdio.h>
 
 #include "randomforest.h"
 #include "mlutil.h"
@@ -34,18 +37,68 @@ namespace puml {
 
 static const ml_string &RF_BASEINFO_FILE = "rf.json";
 static const ml_string &RF_MLID_FILE = "mlid.json";
+static const ml_string &RF_CHECKPOINT_TMP_PREFIX = "tmp.";
+
+//
+// the row samples of a tree and the copies of them made while splitting nodes 
+// (perform_split reserves the size of the node for each side) hold about this 
+// many row references per sampled row
+//
+static const std::size_t RF_ROW_REFERENCES_PER_SAMPLED_ROW = 5;
+
+
+//
+// wall clock deadline for training (none with a budget of 0 seconds). another
+// tree (or batch of trees) is started only if it would finish before the deadline
+// at the average time of the ones finished so far.
+//
+class rf_deadline final {
+ public:
+  explicit rf_deadline(ml_double budget_seconds) :
+    enabled_(budget_seconds > 0.0),
+    start_(std::chrono::steady_clock::now()),
+    end_(start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<ml_double>(budget_seconds))) {}
+
+  bool allows_another(ml_uint finished) const {
+    if(!enabled_) {
+      return(true);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if(now >= end_) {
+      return(false);
+    }
+
+    return((finished == 0) || ((now + ((now - start_) / finished)) <= end_));
+  }
+
+ private:
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point end_;
+};
+
 
 struct rf_thread_config {
 
   rf_thread_config(ml_uint tindex, ml_uint ntrees,
-		   const decision_tree &ptree, const ml_data &data) :
+		   const decision_tree &ptree, const ml_data_view &data,
+		   ml_uint ssize, bool replacement, bool track_oob,
+		   const rf_deadline &train_deadline) :
     thread_index(tindex), number_of_trees(ntrees),
-    proto_tree(ptree), mld(data) {}
+    proto_tree(ptree), mld(data), sample_size(ssize),
+    sample_with_replacement(replacement), collect_oob(track_oob),
+    deadline(train_deadline) {}
 
   ml_uint thread_index;
   ml_uint number_of_trees;
   decision_tree proto_tree;
-  const ml_data &mld;
+  const ml_data_view &mld;
+  ml_uint sample_size;
+  bool sample_with_replacement;
+  bool collect_oob;
+  rf_deadline deadline;
+  bool out_of_time = false;
 
   ml_vector<rf_oob_indices> oobs;
   ml_vector<decision_tree> trees;
@@ -91,19 +144,105 @@ static void init_outofbag_indices(ml_uint size, rf_oob_indices &oob) {
 }
 
 
-static void bootstrapped_sample_from_data(const ml_data &mld, ml_rng &rng, 
-					  ml_data &bootstrapped, rf_oob_indices &oob) {
+//
+// number of rows drawn for each tree given the max_samples setting
+// (<= 0: all rows, (0,1]: fraction of rows, > 1: row count)
+//
+static ml_uint sample_size_for_data(std::size_t size, ml_double max_samples) {
+
+  if(max_samples <= 0.0) {
+    return(size);
+  }
+
+  ml_double sample_size = (max_samples <= 1.0) ? ((max_samples * size) + 0.5) : max_samples;
+  if(sample_size < 1.0) {
+    return(1);
+  }
+
+  return((sample_size < size) ? (ml_uint) sample_size : size);
+}
+
+
+//
+// the sample size shrunk (if needed) so the working set of the trees built at the 
+// same time, bytes_per_row for each sampled row of each tree, fits the memory budget
+//
+ml_uint random_forest::sample_size_for_memory_budget(ml_uint sample_size, std::size_t bytes_per_row, ml_uint concurrent_trees) const {
+
+  if((memory_budget_ == 0) || (sample_size == 0)) {
+    return(sample_size);
+  }
+
+  uint64_t row_budget = memory_budget_ / (bytes_per_row * std::max(concurrent_trees, (ml_uint) 1));
+  if(row_budget >= sample_size) {
+    return(sample_size);
+  }
+
+  ml_uint budget_sample_size = std::max(row_budget, (uint64_t) 1);
+  log_warn("rf sample size reduced from %u to %u rows to fit the memory budget\n", sample_size, budget_sample_size);
+  return(budget_sample_size);
+}
+
+
+static ml_string stop_reason_for_time_budget(std::size_t trees) {
+  return(string_format("time budget reached at %u trees", (ml_uint) trees));
+}
+
+
+//
+// row indices of a sample of sample_size rows (in the order they're drawn)
+//
+static void sample_indices_from_data(std::size_t size, ml_rng &rng, 
+				     ml_uint sample_size, bool with_replacement,
+				     ml_vector<ml_uint> &sample_indices) {
+
+  sample_indices.clear();
+  sample_indices.reserve(sample_size);
+
+  if(with_replacement) {
+    for(std::size_t ii=0; ii < sample_size; ++ii) {
+      sample_indices.push_back(rng.random_number() % size);
+    }
+  }
+  else {
+    //
+    // partial fisher-yates shuffle of the row indices, the first sample_size 
+    // entries are the sample. only the entries moved by a swap are stored 
+    // (every other entry holds its own index) so the cost is that of the sample
+    //
+    ml_map<ml_uint, ml_uint> moved;
+    moved.reserve(sample_size);
+    for(std::size_t ii=0; ii < sample_size; ++ii) {
+      ml_uint jj = ii + (rng.random_number() % (size - ii));
+      auto it = moved.find(jj);
+      ml_uint index = (it != moved.end()) ? it->second : jj;
+      it = moved.find(ii);
+      moved[jj] = (it != moved.end()) ? it->second : ii;
+      sample_indices.push_back(index);
+    }
+  }
+
+}
+
+
+static void bootstrapped_sample_from_data(const ml_data_view &mld, ml_rng &rng, 
+					  ml_uint sample_size, bool with_replacement,
+					  ml_data &bootstrapped, rf_oob_indices *oob) {
+
+  ml_vector<ml_uint> sample_indices;
+  sample_indices_from_data(mld.size(), rng, sample_size, with_replacement, sample_indices);
 
   bootstrapped.clear();
-  init_outofbag_indices(mld.size(), oob);
+  bootstrapped.reserve(sample_size);
 
-  for(std::size_t ii=0; ii < mld.size(); ++ii) {
-    ml_uint index = rng.random_number() % mld.size();
-    bootstrapped.push_back(mld[index]);
+  if(oob) {
+    init_outofbag_indices(mld.size(), *oob);
+  }
 
-    rf_oob_indices::iterator oobit = oob.find(index);
-    if(oobit != oob.end()) {
-      oob.erase(oobit);
+  for(const auto &index : sample_indices) {
+    bootstrapped.push_back(mld[index]);
+    if(oob) {
+      oob->erase(index);
     }
   }
 
@@ -111,31 +250,67 @@ static void bootstrapped_sample_from_data(const ml_data &mld, ml_rng &rng,
 
 
 void random_forest::set_trees(const ml_vector<decision_tree> &trees) {
-  oob_predictions_.clear();
+  reset_out_of_bag(0);
+  forest_feature_importance_.clear();
   feature_importance_.clear();
   trees_ = trees;
 }
 
 
-void random_forest::evaluate_out_of_bag(const ml_data &mld, const ml_vector<rf_oob_indices> &oobs) {
-  
+void random_forest::reset_out_of_bag(std::size_t size) {
+  ml_uint categories = ((size > 0) && (type_ == ml_model_type::classification)) ? mlid_[index_of_feature_to_predict_]->discrete_values.size() : 0;
   oob_predictions_.clear();
-  random_forest oob_forest = *this;
+  oob_error_ = 0.0;
+  oob_counts_.assign(size, 0);
+  oob_sums_.assign((type_ == ml_model_type::regression) ? size : 0, 0.0);
+  oob_votes_.assign(size * categories, 0);
+}
 
-  for(ml_uint instance_index = 0; instance_index < mld.size(); ++instance_index) {
-    
-    // find all trees that were built without this instance (it's in their out-of-bag set)
-    ml_vector<decision_tree> oob_trees;
-    for(std::size_t tree_index = 0; tree_index < trees_.size(); ++tree_index) {
-      if(oobs[tree_index].find(instance_index) != oobs[tree_index].end()) {
-	oob_trees.push_back(trees_[tree_index]);
+
+//
+// add the predictions of trees [first_tree, first_tree + oobs.size()) for the instances 
+// in their out-of-bag sets to the out-of-bag totals and update the out-of-bag 
+// predictions (the mode or mean of the trees that were built without the instance)
+//
+void random_forest::add_trees_to_out_of_bag(const ml_data_view &mld, ml_uint first_tree, const ml_vector<rf_oob_indices> &oobs) {
+
+  ml_uint categories = (type_ == ml_model_type::classification) ? mlid_[index_of_feature_to_predict_]->discrete_values.size() : 0;
+
+  for(std::size_t ii = 0; ii < oobs.size(); ++ii) {
+    const decision_tree &tree = trees_[first_tree + ii];
+    for(const auto &instance_index : oobs[ii]) {
+      ml_feature_value prediction = tree.evaluate(*mld[instance_index]);
+      oob_counts_[instance_index] += 1;
+      if(type_ == ml_model_type::classification) {
+	oob_votes_[(instance_index * categories) + prediction.discrete_value_index] += 1;
+      }
+      else {
+	oob_sums_[instance_index] += prediction.continuous_value;
       }
     }
+  }
 
-    oob_forest.set_trees(oob_trees);    
-    ml_feature_value prediction = oob_forest.evaluate(*mld[instance_index]);
-    oob_predictions_.push_back(prediction);
-  } 
+  oob_predictions_.assign(mld.size(), ml_feature_value{});
+  for(std::size_t instance_index = 0; instance_index < mld.size(); ++instance_index) {
+    if(oob_counts_[instance_index] == 0) {
+      continue;
+    }
+
+    if(type_ == ml_model_type::classification) {
+      // ties go to the lowest category (as in evaluate())
+      const ml_uint *votes = &oob_votes_[instance_index * categories];
+      ml_uint predicted_discrete_value_index = 0;
+      for(ml_uint category = 1; category < categories; ++category) {
+	if(votes[category] > votes[predicted_discrete_value_index]) {
+	  predicted_discrete_value_index = category;
+	}
+      }
+      oob_predictions_[instance_index].discrete_value_index = predicted_discrete_value_index;
+    }
+    else {
+      oob_predictions_[instance_index].continuous_value = oob_sums_[instance_index] / oob_counts_[instance_index];
+    }
+  }
 
 }
 
@@ -188,23 +363,44 @@ static ml_vector<feature_importance_tuple> calculate_feature_importance(const ml
   return(feature_importance_norm);
 }
 
-bool random_forest::single_threaded_train(const ml_data &mld, 
+//
+// an untrained tree with the forest's tree build parameters
+//
+decision_tree random_forest::tree_for_training(ml_uint seed) const {
+  decision_tree tree{mlid_, index_of_feature_to_predict_, 
+      max_tree_depth_, min_leaf_instances_, 
+      features_to_consider_per_node_, seed};
+  tree.set_categorical_subset_splits(categorical_subset_splits_);
+  tree.set_extra_trees(extra_trees_);
+  return(tree);
+}
+
+
+bool random_forest::single_threaded_train(const ml_data_view &mld, 
 					  ml_vector<rf_oob_indices> &oobs, 
 					  ml_vector<dt_feature_importance> &forest_feature_importance) {
 
   ml_rng rng(seed_);
+  ml_uint sample_size = sample_size_for_memory_budget(sample_size_for_data(mld.size(), max_samples_), 
+						      RF_ROW_REFERENCES_PER_SAMPLED_ROW * sizeof(ml_instance_ptr), 1);
+  rf_deadline deadline(time_budget_);
 
   for(ml_uint ii=0; ii < number_of_trees_; ++ii) {
+
+    if(!deadline.allows_another(ii)) {
+      stop_reason_ = stop_reason_for_time_budget(ii);
+      log("%s\n", stop_reason_.c_str());
+      break;
+    }
     
     ml_data bootstrapped;
     rf_oob_indices oob;
-    bootstrapped_sample_from_data(mld, rng, bootstrapped, oob);
+    bootstrapped_sample_from_data(mld, rng, sample_size, sample_with_replacement_, 
+				  bootstrapped, evaluate_oob_ ? &oob : nullptr);
 
     log("\nbuilding tree %d...\n", ii+1);
 
-    decision_tree tree{mlid_, index_of_feature_to_predict_, 
-	max_tree_depth_, min_leaf_instances_, 
-        features_to_consider_per_node_, seed_};
+    decision_tree tree = tree_for_training(seed_);
 
     if(!tree.train(bootstrapped)) {
       log_error("rf failed to build decision tree...");
@@ -227,9 +423,15 @@ static void multi_threaded_work(rf_thread_config_ptr rftc) {
 
   for(ml_uint ii=0; ii < rftc->number_of_trees; ++ii) {
 
+    if(!rftc->deadline.allows_another(ii)) {
+      rftc->out_of_time = true;
+      break;
+    }
+
     ml_data bootstrapped;
     rf_oob_indices oob; 
-    bootstrapped_sample_from_data(rftc->mld, rng, bootstrapped, oob);
+    bootstrapped_sample_from_data(rftc->mld, rng, rftc->sample_size, rftc->sample_with_replacement,
+				  bootstrapped, rftc->collect_oob ? &oob : nullptr);
     
     log("%s building tree %d...\n", rftc->proto_tree.name().c_str(), ii+1);
     
@@ -246,12 +448,15 @@ static void multi_threaded_work(rf_thread_config_ptr rftc) {
 }
 
 
-bool random_forest::multi_threaded_train(const ml_data &mld, 
+bool random_forest::multi_threaded_train(const ml_data_view &mld, 
 					 ml_vector<rf_oob_indices> &oobs, 
 					 ml_vector<dt_feature_importance> &forest_feature_importance) {
 
   ml_vector<std::thread> work_threads;
   ml_vector<rf_thread_config_ptr> thread_configs;
+  ml_uint sample_size = sample_size_for_memory_budget(sample_size_for_data(mld.size(), max_samples_), 
+						      RF_ROW_REFERENCES_PER_SAMPLED_ROW * sizeof(ml_instance_ptr), number_of_threads_);
+  rf_deadline deadline(time_budget_);
 
   // init thread input (# trees to build, custom seed, etc) and spawn the threads
   for(ml_uint thread_index = 0; thread_index < number_of_threads_; ++thread_index) {
@@ -259,13 +464,12 @@ bool random_forest::multi_threaded_train(const ml_data &mld,
     ml_uint ntrees = (number_of_trees_ / number_of_threads_);
     ntrees += (thread_index == 0) ? (number_of_trees_ % number_of_threads_) : 0;
 
-    decision_tree proto_tree{mlid_, index_of_feature_to_predict_, 
-	max_tree_depth_, min_leaf_instances_, 
-        features_to_consider_per_node_, seed_ + thread_index};
+    decision_tree proto_tree = tree_for_training(seed_ + thread_index);
 
     proto_tree.set_name(string_format("[thread %d]", thread_index));
 
-    auto rftc = std::make_shared<rf_thread_config>(thread_index, ntrees, proto_tree, mld);
+    auto rftc = std::make_shared<rf_thread_config>(thread_index, ntrees, proto_tree, mld,
+						   sample_size, sample_with_replacement_, evaluate_oob_, deadline);
     thread_configs.push_back(rftc);
     work_threads.emplace_back(std::thread([rftc] { multi_threaded_work(rftc); }));
   }
@@ -278,14 +482,17 @@ bool random_forest::multi_threaded_train(const ml_data &mld,
 
 						
   // combine trees, out of bag maps, and feature importance
+  // (threads that ran out of time have fewer trees)
+  bool out_of_time = false;
   for(auto &thread_config : thread_configs) {
 
-    if(thread_config->trees.size() != thread_config->number_of_trees) {
+    if((thread_config->trees.size() != thread_config->number_of_trees) && !thread_config->out_of_time) {
       log_error("some trees failed to build in thread %d\n", thread_config->thread_index);
       return(false);
     }
 
-    for(ml_uint tree_index = 0; tree_index < thread_config->number_of_trees; ++tree_index) {
+    out_of_time = out_of_time || thread_config->out_of_time;
+    for(ml_uint tree_index = 0; tree_index < thread_config->trees.size(); ++tree_index) {
       oobs.push_back(thread_config->oobs[tree_index]);
       trees_.push_back(thread_config->trees[tree_index]);
       collect_feature_importance(thread_config->trees[tree_index].feature_importance(), forest_feature_importance);
@@ -293,37 +500,554 @@ bool random_forest::multi_threaded_train(const ml_data &mld,
 
   }
 
+  if(out_of_time) {
+    stop_reason_ = stop_reason_for_time_budget(trees_.size());
+    log("%s\n", stop_reason_.c_str());
+  }
+
   return(true);
 }
 
 
-bool random_forest::train(const ml_data &mld) {
+bool random_forest::train(const ml_data_view &mld) {
 
   trees_.clear();
   feature_importance_.clear();
-  oob_predictions_.clear();
+  forest_feature_importance_.clear();
+  reset_out_of_bag(0);
+  stop_reason_.clear();
 
   if(mlid_.empty()) {
     log_error("rf train() invalid instance definition...\n");
     return(false);
   }
 
+  forest_feature_importance_.resize(mlid_.size());
+
+  //
+  // with early stopping (or checkpointing) the trees are built in batches with per 
+  // tree seeds (as train_more) so the out-of-bag error can be checked (and the trees
+  // written) as they complete
+  //
+  if((early_stopping_window_ > 0) || !checkpoint_path_.empty()) {
+    if(mld.empty()) {
+      log_error("rf train() empty instance data set...\n");
+      return(false);
+    }
+    reset_out_of_bag((evaluate_oob_ || (early_stopping_window_ > 0)) ? mld.size() : 0);
+    oob_errors_.clear();
+    if(!checkpoint_path_.empty() && !start_checkpoint()) {
+      return(false);
+    }
+    return(add_trees(mld, number_of_trees_));
+  }
+
   ml_vector<rf_oob_indices> oobs;
-  ml_vector<dt_feature_importance> forest_feature_importance;
-  forest_feature_importance.resize(mlid_.size());
 
-  bool forest_was_built = (number_of_threads_ <= 1) ? single_threaded_train(mld, oobs, forest_feature_importance) :
-    multi_threaded_train(mld, oobs, forest_feature_importance);
+  bool forest_was_built = (number_of_threads_ <= 1) ? single_threaded_train(mld, oobs, forest_feature_importance_) :
+    multi_threaded_train(mld, oobs, forest_feature_importance_);
 
   if(!forest_was_built) {
     log_error("hit a snag while building the forest...\n");
     return(false);
   }
 
-  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance);
+  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
 
   if(evaluate_oob_) {
-    evaluate_out_of_bag(mld, oobs);
+    reset_out_of_bag(mld.size());
+    add_trees_to_out_of_bag(mld, 0, oobs);
+    oob_error_ = out_of_bag_error(mld);
+  }
+
+  return(true);
+}
+
+
+bool random_forest::train_more(const ml_data_view &mld, ml_uint number_of_trees) {
+
+  if(mlid_.empty() || mld.empty()) {
+    log_error("rf train_more() invalid instance definition or empty data...\n");
+    return(false);
+  }
+
+  if(forest_feature_importance_.size() != mlid_.size()) {
+    forest_feature_importance_.assign(mlid_.size(), dt_feature_importance{});
+  }
+
+  if((evaluate_oob_ || (early_stopping_window_ > 0)) && (oob_counts_.size() != mld.size())) {
+    if(!trees_.empty()) {
+      log_warn("out-of-bag predictions only include the trees added by train_more()\n");
+    }
+    reset_out_of_bag(mld.size());
+    oob_errors_.clear();
+  }
+
+  // the checkpoint's target is the grown forest (so resume() finishes it)
+  number_of_trees_ = trees_.size() + number_of_trees;
+  if(!checkpoint_path_.empty() && !start_checkpoint()) {
+    return(false);
+  }
+
+  if(!add_trees(mld, number_of_trees)) {
+    return(false);
+  }
+
+  number_of_trees_ = trees_.size();
+
+  return(true);
+}
+
+
+//
+// the out-of-bag error of the forest: the error rate (classification) or mean 
+// squared error (regression) of the instances with out-of-bag predictions
+//
+ml_double random_forest::out_of_bag_error(const ml_data_view &mld) const {
+
+  ml_uint count = 0;
+  ml_double error = 0;
+  for(std::size_t instance_index = 0; instance_index < oob_predictions_.size(); ++instance_index) {
+    if(oob_counts_[instance_index] == 0) {
+      continue;
+    }
+
+    ++count;
+    const ml_feature_value &target = (*mld[instance_index])[index_of_feature_to_predict_];
+    if(type_ == ml_model_type::classification) {
+      error += (oob_predictions_[instance_index].discrete_value_index != target.discrete_value_index) ? 1.0 : 0.0;
+    }
+    else {
+      ml_double delta = oob_predictions_[instance_index].continuous_value - target.continuous_value;
+      error += (delta * delta);
+    }
+  }
+
+  return((count > 0) ? (error / count) : 0.0);
+}
+
+
+//
+// early stopping: true when the out-of-bag error improved by less than the tolerance 
+// (relative to the error of early_stopping_window_ trees before) over the last window
+// of trees (see oob_errors_)
+//
+bool random_forest::out_of_bag_error_converged() const {
+
+  const ml_vector<std::pair<ml_uint, ml_double>> &errors = oob_errors_;
+  if(errors.empty() || (errors.back().first <= early_stopping_window_)) {
+    return(false);
+  }
+
+  ml_uint window_start = errors.back().first - early_stopping_window_;
+  for(auto it = errors.rbegin(); it != errors.rend(); ++it) {
+    if(it->first <= window_start) {
+      ml_double improvement = it->second - errors.back().second;
+      return(improvement <= (early_stopping_tolerance_ * it->second));
+    }
+  }
+
+  return(false);
+}
+
+
+//
+// add up to number_of_trees trees with per tree seeds (see train_more), updating
+// the out-of-bag totals, stopping early once the out-of-bag error converges 
+// (when early stopping is set) and writing checkpoints (when checkpointing)
+//
+bool random_forest::add_trees(const ml_data_view &mld, ml_uint number_of_trees) {
+
+  bool track_oob = evaluate_oob_ || (early_stopping_window_ > 0);
+  ml_uint first_tree = trees_.size();
+  ml_uint batch_size = (number_of_threads_ > 1) ? number_of_threads_ : 1;
+  ml_uint sample_size = sample_size_for_memory_budget(sample_size_for_data(mld.size(), max_samples_), 
+						      RF_ROW_REFERENCES_PER_SAMPLED_ROW * sizeof(ml_instance_ptr), batch_size);
+  rf_deadline deadline(time_budget_);
+  bool out_of_time = false;
+
+  stop_reason_.clear();
+
+  //
+  // trees are built in batches (one per thread), the sample of each tree is drawn 
+  // with the tree's own seed
+  //
+  for(ml_uint added = 0; added < number_of_trees; added += batch_size) {
+
+    if(!deadline.allows_another(added / batch_size)) {
+      stop_reason_ = stop_reason_for_time_budget(trees_.size());
+      log("%s\n", stop_reason_.c_str());
+      out_of_time = true;
+      break;
+    }
+
+    ml_uint batch_trees = std::min(batch_size, number_of_trees - added);
+    ml_vector<ml_data> samples(batch_trees);
+    ml_vector<rf_oob_indices> oobs(batch_trees);
+    ml_vector<decision_tree> batch;
+
+    for(ml_uint ii = 0; ii < batch_trees; ++ii) {
+      ml_uint tree_seed = seed_ + first_tree + added + ii;
+      ml_rng rng(tree_seed);
+      bootstrapped_sample_from_data(mld, rng, sample_size, sample_with_replacement_, 
+				    samples[ii], track_oob ? &oobs[ii] : nullptr);
+      batch.push_back(tree_for_training(tree_seed));
+    }
+
+    ml_uint batch_first_tree = trees_.size();
+    if(!train_batch(batch_first_tree, batch, [&samples](decision_tree &tree, ml_uint ii) { return(tree.train(samples[ii])); }, 
+		    forest_feature_importance_)) {
+      return(false);
+    }
+
+    if(track_oob) {
+      add_trees_to_out_of_bag(mld, batch_first_tree, oobs);
+      oob_error_ = out_of_bag_error(mld);
+      oob_errors_.push_back(std::make_pair((ml_uint) trees_.size(), oob_error_));
+    }
+
+    bool converged = (early_stopping_window_ > 0) && out_of_bag_error_converged();
+    if(converged) {
+      stop_reason_ = string_format("out-of-bag error converged at %u trees (%.6f)", (ml_uint) trees_.size(), oob_error_);
+      log("%s\n", stop_reason_.c_str());
+    }
+
+    if(!checkpoint_path_.empty()) {
+      if(!write_checkpoint_trees(batch_first_tree)) {
+	return(false);
+      }
+      if(!converged && ((trees_.size() - checkpoint_trees_written_) >= checkpoint_trees_) && !write_checkpoint(false)) {
+	return(false);
+      }
+    }
+
+    if(converged) {
+      break;
+    }
+  }
+
+  if(stop_reason_.empty() && (early_stopping_window_ > 0)) {
+    stop_reason_ = string_format("reached %u trees", (ml_uint) trees_.size());
+  }
+
+  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
+
+  // a forest that ran out of time can be finished with resume()
+  if(!checkpoint_path_.empty() && !write_checkpoint(!out_of_time)) {
+    return(false);
+  }
+
+  return(true);
+}
+
+
+//
+// train the trees of a batch (one per thread) with train_tree(tree, index in 
+// batch) and add them to the forest
+//
+bool random_forest::train_batch(ml_uint first_tree, ml_vector<decision_tree> &batch, 
+				const std::function<bool (decision_tree &tree, ml_uint index)> &train_tree,
+				ml_vector<dt_feature_importance> &forest_feature_importance) {
+
+  ml_vector<char> built(batch.size(), 0);
+
+  ml_vector<std::thread> work_threads;
+  for(ml_uint ii = 1; ii < batch.size(); ++ii) {
+    work_threads.emplace_back(std::thread([&batch, &train_tree, &built, ii] { built[ii] = train_tree(batch[ii], ii); }));
+  }
+
+  built[0] = train_tree(batch[0], 0);
+
+  for(auto &thread : work_threads) {
+    thread.join();
+  }
+
+  for(ml_uint ii = 0; ii < batch.size(); ++ii) {
+    if(!built[ii]) {
+      log_error("rf failed to build decision tree %d...\n", first_tree + ii + 1);
+      return(false);
+    }
+
+    log("built tree %d...\n", first_tree + ii + 1);
+    collect_feature_importance(batch[ii].feature_importance(), forest_feature_importance);
+    trees_.push_back(batch[ii]);
+  }
+
+  return(true);
+}
+
+
+//
+// (row index, position in the sample) pairs sorted by row index, so the rows of
+// several samples can be gathered with one pass over a data reader
+//
+using rf_sample_rows = ml_vector<std::pair<ml_uint, ml_uint>>;
+
+static bool gather_samples_from_reader(ml_data_reader &reader, const ml_vector<rf_sample_rows> &sample_rows, 
+				       ml_vector<ml_data> &samples) {
+
+  if(!reader.rewind()) {
+    return(false);
+  }
+
+  ml_vector<std::size_t> next_row(sample_rows.size(), 0);
+  ml_data chunk;
+  while(reader.read_chunk(chunk)) {
+    uint64_t chunk_end = reader.position();
+    uint64_t chunk_begin = chunk_end - chunk.size();
+    for(std::size_t ii = 0; ii < sample_rows.size(); ++ii) {
+      const rf_sample_rows &rows = sample_rows[ii];
+      for(std::size_t &jj = next_row[ii]; (jj < rows.size()) && (rows[jj].first < chunk_end); ++jj) {
+	samples[ii][rows[jj].second] = chunk[rows[jj].first - chunk_begin];
+      }
+    }
+  }
+
+  if(!reader.good()) {
+    return(false);
+  }
+
+  for(std::size_t ii = 0; ii < sample_rows.size(); ++ii) {
+    if(next_row[ii] != sample_rows[ii].size()) {
+      log_error("data reader returned fewer instances than expected\n");
+      return(false);
+    }
+  }
+
+  return(true);
+}
+
+
+bool random_forest::train(ml_data_reader &reader) {
+
+  trees_.clear();
+  feature_importance_.clear();
+  reset_out_of_bag(0);
+  stop_reason_.clear();
+
+  if(mlid_.empty() || !reader.good()) {
+    log_error("rf train() invalid instance definition or data reader...\n");
+    return(false);
+  }
+
+  uint64_t instance_count = reader.instance_count();
+  if((instance_count == 0) || (instance_count > std::numeric_limits<ml_uint>::max())) {
+    log_error("rf train() can't sample from %llu instances...\n", (unsigned long long) instance_count);
+    return(false);
+  }
+
+  if(evaluate_oob_ || (early_stopping_window_ > 0)) {
+    log_warn("out-of-bag evaluation (and early stopping) isn't available when training from a data reader\n");
+  }
+
+  ml_rng rng(seed_);
+  ml_uint batch_size = (number_of_threads_ > 1) ? number_of_threads_ : 1;
+  std::size_t instance_bytes = sizeof(ml_instance) + (mlid_.size() * sizeof(ml_feature_value)) + sizeof(ml_instance_ptr);
+  ml_uint sample_size = sample_size_for_memory_budget(sample_size_for_data(instance_count, max_samples_), 
+						      (RF_ROW_REFERENCES_PER_SAMPLED_ROW * sizeof(ml_instance_ptr)) + instance_bytes, batch_size);
+  rf_deadline deadline(time_budget_);
+  forest_feature_importance_.assign(mlid_.size(), dt_feature_importance{});
+
+  //
+  // trees are built in batches (one per thread). the samples for a batch are drawn 
+  // (as in single_threaded_train) and then gathered with one pass over the data, so 
+  // only the sampled instances of the batch are held in memory.
+  //
+  for(ml_uint first_tree = 0; first_tree < number_of_trees_; first_tree += batch_size) {
+
+    if(!deadline.allows_another(first_tree / batch_size)) {
+      stop_reason_ = stop_reason_for_time_budget(trees_.size());
+      log("%s\n", stop_reason_.c_str());
+      break;
+    }
+
+    ml_uint batch_trees = std::min(batch_size, number_of_trees_ - first_tree);
+    ml_vector<rf_sample_rows> sample_rows(batch_trees);
+    ml_vector<ml_data> samples(batch_trees);
+    ml_vector<ml_uint> sample_indices;
+
+    for(ml_uint ii = 0; ii < batch_trees; ++ii) {
+      sample_indices_from_data(instance_count, rng, sample_size, sample_with_replacement_, sample_indices);
+      for(ml_uint position = 0; position < sample_indices.size(); ++position) {
+	sample_rows[ii].push_back(std::make_pair(sample_indices[position], position));
+      }
+      std::sort(sample_rows[ii].begin(), sample_rows[ii].end());
+      samples[ii].resize(sample_indices.size());
+    }
+
+    if(!gather_samples_from_reader(reader, sample_rows, samples)) {
+      log_error("rf failed to read the training data...\n");
+      return(false);
+    }
+
+    sample_rows.clear();
+
+    ml_vector<decision_tree> batch;
+    for(ml_uint ii = 0; ii < batch_trees; ++ii) {
+      batch.push_back(tree_for_training(seed_ + first_tree + ii));
+    }
+
+    if(!train_batch(first_tree, batch, [&samples](decision_tree &tree, ml_uint ii) { return(tree.train(samples[ii])); }, 
+		    forest_feature_importance_)) {
+      return(false);
+    }
+  }
+
+  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
+
+  return(true);
+}
+
+
+bool random_forest::train(const ml_sparse_data &mlsd) {
+
+  trees_.clear();
+  feature_importance_.clear();
+  reset_out_of_bag(0);
+  stop_reason_.clear();
+
+  if(mlid_.empty() || mlsd.empty()) {
+    log_error("rf train() invalid instance definition or empty sparse data...\n");
+    return(false);
+  }
+
+  if(evaluate_oob_ || (early_stopping_window_ > 0)) {
+    log_warn("out-of-bag evaluation (and early stopping) isn't available when training from sparse data\n");
+  }
+
+  ml_rng rng(seed_);
+  ml_uint batch_size = (number_of_threads_ > 1) ? number_of_threads_ : 1;
+  ml_uint sample_size = sample_size_for_memory_budget(sample_size_for_data(mlsd.size(), max_samples_), 
+						      RF_ROW_REFERENCES_PER_SAMPLED_ROW * sizeof(ml_uint), batch_size);
+  rf_deadline deadline(time_budget_);
+  forest_feature_importance_.assign(mlid_.size(), dt_feature_importance{});
+
+  //
+  // samples are row indices drawn as in single_threaded_train, trees are built 
+  // in batches (one per thread)
+  //
+  for(ml_uint first_tree = 0; first_tree < number_of_trees_; first_tree += batch_size) {
+
+    if(!deadline.allows_another(first_tree / batch_size)) {
+      stop_reason_ = stop_reason_for_time_budget(trees_.size());
+      log("%s\n", stop_reason_.c_str());
+      break;
+    }
+
+    ml_uint batch_trees = std::min(batch_size, number_of_trees_ - first_tree);
+    ml_vector<ml_vector<ml_uint>> samples(batch_trees);
+    for(auto &sample : samples) {
+      sample_indices_from_data(mlsd.size(), rng, sample_size, sample_with_replacement_, sample);
+    }
+
+    ml_vector<decision_tree> batch;
+    for(ml_uint ii = 0; ii < batch_trees; ++ii) {
+      batch.push_back(tree_for_training(seed_ + first_tree + ii));
+    }
+
+    if(!train_batch(first_tree, batch, [&mlsd, &samples](decision_tree &tree, ml_uint ii) { return(tree.train(mlsd, samples[ii])); }, 
+		    forest_feature_importance_)) {
+      return(false);
+    }
+  }
+
+  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
+
+  return(true);
+}
+
+
+bool random_forest::train(const ml_prepared_data &mlpd) {
+
+  ml_vector<ml_uint> rows(mlpd.size());
+  for(std::size_t ii = 0; ii < rows.size(); ++ii) {
+    rows[ii] = ii;
+  }
+
+  return(train(mlpd, rows));
+}
+
+
+bool random_forest::train(const ml_prepared_data &mlpd, const ml_vector<ml_uint> &rows) {
+
+  trees_.clear();
+  feature_importance_.clear();
+  reset_out_of_bag(0);
+  stop_reason_.clear();
+
+  if(mlid_.empty() || mlpd.empty() || rows.empty()) {
+    log_error("rf train() invalid instance definition or empty prepared data...\n");
+    return(false);
+  }
+
+  if((early_stopping_window_ > 0) || !checkpoint_path_.empty()) {
+    log_warn("early stopping and checkpointing aren't available when training from prepared data\n");
+  }
+
+  //
+  // the training rows as a view of the prepared instances, out-of-bag
+  // sets are positions in rows (as for any view)
+  //
+  ml_data_view mld(mlpd.mld, std::make_shared<const ml_vector<ml_uint>>(rows), {ml_data_view::ml_row_range(0, rows.size())});
+
+  ml_rng rng(seed_);
+  ml_uint batch_size = (number_of_threads_ > 1) ? number_of_threads_ : 1;
+  ml_uint sample_size = sample_size_for_memory_budget(sample_size_for_data(rows.size(), max_samples_), 
+						      RF_ROW_REFERENCES_PER_SAMPLED_ROW * sizeof(ml_uint), batch_size);
+  rf_deadline deadline(time_budget_);
+  forest_feature_importance_.assign(mlid_.size(), dt_feature_importance{});
+  if(evaluate_oob_) {
+    reset_out_of_bag(rows.size());
+  }
+
+  //
+  // samples are positions in rows drawn as in single_threaded_train, trees 
+  // are built in batches (one per thread)
+  //
+  for(ml_uint first_tree = 0; first_tree < number_of_trees_; first_tree += batch_size) {
+
+    if(!deadline.allows_another(first_tree / batch_size)) {
+      stop_reason_ = stop_reason_for_time_budget(trees_.size());
+      log("%s\n", stop_reason_.c_str());
+      break;
+    }
+
+    ml_uint batch_trees = std::min(batch_size, number_of_trees_ - first_tree);
+    ml_vector<ml_vector<ml_uint>> samples(batch_trees);
+    ml_vector<rf_oob_indices> oobs(batch_trees);
+    ml_vector<ml_uint> positions;
+    for(ml_uint ii = 0; ii < batch_trees; ++ii) {
+      sample_indices_from_data(rows.size(), rng, sample_size, sample_with_replacement_, positions);
+      if(evaluate_oob_) {
+	init_outofbag_indices(rows.size(), oobs[ii]);
+      }
+      for(const auto &position : positions) {
+	samples[ii].push_back(rows[position]);
+	if(evaluate_oob_) {
+	  oobs[ii].erase(position);
+	}
+      }
+    }
+
+    ml_vector<decision_tree> batch;
+    for(ml_uint ii = 0; ii < batch_trees; ++ii) {
+      batch.push_back(tree_for_training(seed_ + first_tree + ii));
+    }
+
+    if(!train_batch(first_tree, batch, [&mlpd, &samples](decision_tree &tree, ml_uint ii) { return(tree.train(mlpd, samples[ii])); }, 
+		    forest_feature_importance_)) {
+      return(false);
+    }
+
+    if(evaluate_oob_) {
+      add_trees_to_out_of_bag(mld, first_tree, oobs);
+    }
+  }
+
+  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
+
+  if(evaluate_oob_) {
+    oob_error_ = out_of_bag_error(mld);
   }
 
   return(true);
@@ -331,6 +1055,75 @@ bool random_forest::train(const ml_data &mld) {
 
 
 ml_feature_value random_forest::evaluate(const ml_instance &instance) const {
+  return(evaluate_trees([&instance](const decision_tree &tree) { return(tree.evaluate(instance)); }));
+}
+
+
+ml_feature_value random_forest::evaluate(const ml_sparse_data &mlsd, std::size_t row) const {
+  return(evaluate_trees([&mlsd, row](const decision_tree &tree) { return(tree.evaluate(mlsd, row)); }));
+}
+
+
+ml_vector<ml_double> random_forest::predict_proba(const ml_instance &instance) const {
+
+  ml_vector<ml_double> probabilities;
+  if(trees_.empty() || (type_ != ml_model_type::classification)) {
+    log_warn("predict_proba() called on an empty or regression forest\n");
+    return(probabilities);
+  }
+
+  probabilities.assign(mlid_[index_of_feature_to_predict_]->discrete_values.size(), 0.0);
+  for(const auto &tree : trees_) {
+    ml_vector<ml_double> tree_probabilities = tree.predict_proba(instance);
+    for(std::size_t ii = 0; (ii < tree_probabilities.size()) && (ii < probabilities.size()); ++ii) {
+      probabilities[ii] += tree_probabilities[ii];
+    }
+  }
+
+  for(auto &probability : probabilities) {
+    probability /= trees_.size();
+  }
+
+  return(probabilities);
+}
+
+
+ml_vector<ml_vector<ml_double>> random_forest::predict_proba(const ml_data_view &mld) const {
+
+  ml_vector<ml_vector<ml_double>> probabilities(mld.size());
+  if(trees_.empty() || (type_ != ml_model_type::classification)) {
+    log_warn("predict_proba() called on an empty or regression forest\n");
+    return(probabilities);
+  }
+
+  //
+  // contiguous parts of the instances, one per thread (the first in this thread)
+  //
+  std::size_t parts = std::min<std::size_t>(std::max<ml_uint>(1, number_of_threads_), mld.size());
+  auto predict_part = [&](std::size_t part) {
+    for(std::size_t ii = (mld.size() * part) / parts; ii < (mld.size() * (part + 1)) / parts; ++ii) {
+      probabilities[ii] = predict_proba(*mld[ii]);
+    }
+  };
+
+  ml_vector<std::thread> work_threads;
+  for(std::size_t part = 1; part < parts; ++part) {
+    work_threads.emplace_back(std::thread(predict_part, part));
+  }
+
+  if(parts > 0) {
+    predict_part(0);
+  }
+
+  for(auto &thread : work_threads) {
+    thread.join();
+  }
+
+  return(probabilities);
+}
+
+
+ml_feature_value random_forest::evaluate_trees(const std::function<ml_feature_value (const decision_tree &tree)> &evaluate_tree) const {
 
   ml_feature_value rf_eval = {};
 
@@ -346,7 +1139,7 @@ ml_feature_value random_forest::evaluate(const ml_instance &instance) const {
   // evaluate all trees in the forest for the instance
   //
   for(const auto &tree : trees_) {
-    ml_feature_value tree_eval = tree.evaluate(instance);
+    ml_feature_value tree_eval = evaluate_tree(tree);
     if(type_ == ml_model_type::classification) {
       prediction_map[tree_eval.discrete_value_index] += 1;
     }
@@ -391,7 +1184,7 @@ ml_feature_value random_forest::evaluate(const ml_instance &instance) const {
 }
 
 
-bool random_forest::write_random_forest_base_info_to_file(const ml_string &path) const {
+bool random_forest::write_random_forest_base_info_to_file(const ml_string &path, const json &checkpoint_info) const {
 
   json json_object = {{"object", "random_forest"},
 		      {"version", ML_VERSION_STRING},
@@ -403,11 +1196,42 @@ bool random_forest::write_random_forest_base_info_to_file(const ml_string &path)
 		      {"max_tree_depth", max_tree_depth_},
 		      {"min_leaf_instances", min_leaf_instances_},
 		      {"features_to_consider_per_node", features_to_consider_per_node_},
-		      {"evaluate_oob", evaluate_oob_}};
+		      {"evaluate_oob", evaluate_oob_},
+		      {"max_samples", max_samples_},
+		      {"sample_with_replacement", sample_with_replacement_},
+		      {"categorical_subset_splits", categorical_subset_splits_},
+		      {"extra_trees", extra_trees_},
+		      {"early_stopping_window", early_stopping_window_},
+		      {"early_stopping_tolerance", early_stopping_tolerance_},
+		      {"time_budget", time_budget_},
+		      {"memory_budget", memory_budget_}};
+
+  // where and why early stopping stopped training
+  if(!stop_reason_.empty()) {
+    json_object["trees_trained"] = trees_.size();
+    json_object["stop_reason"] = stop_reason_;
+    json_object["oob_error"] = oob_error_;
+  }
+
+  //
+  // feature importance totals (sum of score deltas, node count) per feature
+  //
+  if(!forest_feature_importance_.empty()) {
+    json json_importance = json::array();
+    for(const auto &importance : forest_feature_importance_) {
+      json_importance.push_back({importance.sum_score_delta, importance.count});
+    }
+    json_object["feature_importance"] = json_importance;
+  }
+
+  // checkpoint state (see write_checkpoint)
+  for(auto it = checkpoint_info.begin(); it != checkpoint_info.end(); ++it) {
+    json_object[it.key()] = it.value();
+  }
 
   std::ofstream modelout(path);
   modelout << std::setw(4) << json_object << std::endl; 
-  return(true);
+  return(modelout.good());
 }
 
 
@@ -451,12 +1275,16 @@ bool random_forest::save(const ml_string &path) const {
 }
 
 
-bool random_forest::read_random_forest_base_info_from_file(const ml_string &path) {
+bool random_forest::read_random_forest_base_info_from_file(const ml_string &path, json *base_info) {
 
   std::ifstream jsonfile(path);
   json json_object;
   jsonfile >> json_object;
 
+  if(base_info) {
+    *base_info = json_object;
+  }
+
   ml_string object_name = json_object["object"];
   if(object_name != "random_forest") {
     log_error("json object is not a random forest...\n");
@@ -475,6 +1303,40 @@ bool random_forest::read_random_forest_base_info_from_file(const ml_string &path
     return(false);
   }
 
+  // row subsampling is optional (not present in older models)
+  get_double_value_from_json(json_object, "max_samples", max_samples_);
+  if(!get_bool_value_from_json(json_object, "sample_with_replacement", sample_with_replacement_)) {
+    sample_with_replacement_ = true;
+  }
+
+  // optional (not present in older models)
+  get_bool_value_from_json(json_object, "categorical_subset_splits", categorical_subset_splits_);
+  get_bool_value_from_json(json_object, "extra_trees", extra_trees_);
+  get_numeric_value_from_json(json_object, "early_stopping_window", early_stopping_window_);
+  get_double_value_from_json(json_object, "early_stopping_tolerance", early_stopping_tolerance_);
+  get_double_value_from_json(json_object, "time_budget", time_budget_);
+
+  ml_double memory_budget = 0;
+  if(get_double_value_from_json(json_object, "memory_budget", memory_budget)) {
+    memory_budget_ = (uint64_t) memory_budget;
+  }
+
+  stop_reason_.clear();
+  if(json_object.contains<ml_string>("stop_reason")) {
+    stop_reason_ = json_object["stop_reason"];
+  }
+
+  forest_feature_importance_.clear();
+  if(json_object.contains<ml_string>("feature_importance")) {
+    for(const auto &json_importance : json_object["feature_importance"]) {
+      if(!json_importance.is_array() || (json_importance.size() != 2)) {
+	log_error("malformed feature importance in rf base info\n");
+	return(false);
+      }
+      forest_feature_importance_.push_back(dt_feature_importance{json_importance[0], json_importance[1]});
+    }
+  }
+
   return(true);
 }
 
@@ -495,10 +1357,238 @@ bool random_forest::restore(const ml_string &path) {
     return(false);
   }
 
+  reset_out_of_bag(0);
+  oob_errors_.clear();
+  feature_importance_.clear();
+  if(forest_feature_importance_.size() == mlid_.size()) {
+    feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
+  }
+  else {
+    forest_feature_importance_.clear();
+  }
+
+  return(true);
+}
+
+
+//
+// write the file (a json object) to the checkpoint directory under a temporary 
+// name and rename it into place, so a checkpoint file is either complete or absent
+//
+static bool write_checkpoint_file(const ml_string &dir, const ml_string &file_name, 
+				  const std::function<bool (const ml_string &path)> &write_file) {
+
+  ml_string tmp_path = dir + "/" + RF_CHECKPOINT_TMP_PREFIX + file_name;
+  ml_string path = dir + "/" + file_name;
+  if(!write_file(tmp_path) || (rename(tmp_path.c_str(), path.c_str()) != 0)) {
+    log_error("couldn't write checkpoint file: %s\n", path.c_str());
+    return(false);
+  }
+
+  return(true);
+}
+
+
+//
+// create the checkpoint directory with the instance definition, the trees 
+// trained so far and an initial checkpoint
+//
+bool random_forest::start_checkpoint() {
+
+  checkpoint_trees_written_ = 0;
+  checkpoint_oob_file_.clear();
+
+  if(!prepare_directory_for_model_save(checkpoint_path_)) {
+    return(false);
+  }
+
+  if(!write_instance_definition_to_file(checkpoint_path_ + "/" + RF_MLID_FILE, mlid_)) {
+    log_error("couldn't write rf instance definition to %s\n", RF_MLID_FILE.c_str());
+    return(false);
+  }
+
+  return(write_checkpoint_trees(0) && write_checkpoint(false));
+}
+
+
+//
+// write trees [first_tree, trees_.size()) to the checkpoint directory. trees are 
+// named by their position in the forest (tree1.json, ...), so resume() can read 
+// the ones that belong to a checkpoint
+//
+bool random_forest::write_checkpoint_trees(ml_uint first_tree) const {
+
+  for(std::size_t ii = first_tree; ii < trees_.size(); ++ii) {
+    const decision_tree &tree = trees_[ii];
+    ml_string file_name = puml::TREE_MODEL_FILE_PREFIX + std::to_string(ii+1) + ".json";
+    if(!write_checkpoint_file(checkpoint_path_, file_name, [&tree](const ml_string &path) { return(tree.save(path, true)); })) {
+      return(false);
+    }
+  }
+
+  return(true);
+}
+
+
+//
+// commit a checkpoint of the trees written so far: the out-of-bag totals go to 
+// their own file (oob.<trees>.json) and then the base info, which names the
+// number of trees and the out-of-bag file of the checkpoint, replaces rf.json.
+// complete is false while trees are still to be added.
+//
+bool random_forest::write_checkpoint(bool complete) {
+
+  ml_uint trees = trees_.size();
+  ml_string oob_file;
+  if(!oob_counts_.empty()) {
+    oob_file = "oob." + std::to_string(trees) + ".json";
+    json json_oob = {{"instances", oob_counts_.size()},
+		     {"counts", oob_counts_},
+		     {"sums", oob_sums_},
+		     {"votes", oob_votes_}};
+    if(!write_checkpoint_file(checkpoint_path_, oob_file, [&json_oob](const ml_string &path) {
+	  std::ofstream oobout(path);
+	  oobout << json_oob << std::endl;
+	  return(oobout.good());
+	})) {
+      return(false);
+    }
+  }
+
+  json json_errors = json::array();
+  for(const auto &error : oob_errors_) {
+    json_errors.push_back({error.first, error.second});
+  }
+
+  json checkpoint_info = {{"checkpoint_trees", trees},
+			  {"checkpoint_complete", complete},
+			  {"checkpoint_interval", checkpoint_trees_},
+			  {"checkpoint_oob_file", oob_file},
+			  {"oob_errors", json_errors}};
+
+  if(!write_checkpoint_file(checkpoint_path_, RF_BASEINFO_FILE, [this, &checkpoint_info](const ml_string &path) { 
+	return(write_random_forest_base_info_to_file(path, checkpoint_info)); })) {
+    return(false);
+  }
+
+  if(!checkpoint_oob_file_.empty() && (checkpoint_oob_file_ != oob_file)) {
+    remove((checkpoint_path_ + "/" + checkpoint_oob_file_).c_str());
+  }
+
+  checkpoint_oob_file_ = oob_file;
+  checkpoint_trees_written_ = trees;
+
+  return(true);
+}
+
+
+//
+// restore the out-of-bag totals of a checkpoint (when they are for mld) and
+// recompute the out-of-bag predictions
+//
+bool random_forest::read_checkpoint_out_of_bag(const ml_string &path, const ml_data_view &mld) {
+
+  std::ifstream jsonfile(path);
+  if(!jsonfile.good()) {
+    log_error("couldn't read checkpoint out-of-bag totals: %s\n", path.c_str());
+    return(false);
+  }
+
+  json json_oob;
+  jsonfile >> json_oob;
+
+  ml_uint instances = 0;
+  if(!get_numeric_value_from_json(json_oob, "instances", instances) || (instances != mld.size())) {
+    log_warn("checkpoint out-of-bag totals aren't for this data, out-of-bag predictions only include the resumed trees\n");
+    return(true);
+  }
+
+  oob_counts_ = json_oob["counts"].get<ml_vector<ml_uint>>();
+  oob_sums_ = json_oob["sums"].get<ml_vector<ml_double>>();
+  oob_votes_ = json_oob["votes"].get<ml_vector<ml_uint>>();
+  add_trees_to_out_of_bag(mld, 0, {});
+  oob_error_ = out_of_bag_error(mld);
+
   return(true);
 }
 
 
+bool random_forest::resume(const ml_string &path, const ml_data_view &mld) {
+
+  if(!read_instance_definition_from_file(path + "/" + RF_MLID_FILE, mlid_)) {
+    log_error("couldn't read rf instance defintion\n");
+    return(false);
+  }
+
+  //
+  // the time budget is the caller's (for this run), not the checkpointed one
+  //
+  ml_double time_budget = time_budget_;
+  json base_info;
+  if(!read_random_forest_base_info_from_file(path + "/" + RF_BASEINFO_FILE, &base_info)) {
+    log_error("couldn't read rf base info\n");
+    return(false);
+  }
+  time_budget_ = time_budget;
+
+  ml_uint checkpoint_trees = 0;
+  bool complete = false;
+  if(!(get_numeric_value_from_json(base_info, "checkpoint_trees", checkpoint_trees) &&
+       get_bool_value_from_json(base_info, "checkpoint_complete", complete))) {
+    log_error("no checkpoint to resume in %s\n", path.c_str());
+    return(false);
+  }
+
+  get_numeric_value_from_json(base_info, "checkpoint_interval", checkpoint_trees_);
+  checkpoint_path_ = path;
+  checkpoint_trees_written_ = checkpoint_trees;
+  checkpoint_oob_file_ = base_info.value("checkpoint_oob_file", "");
+
+  // the trees of the checkpoint (later ones may be from an unfinished batch)
+  trees_.clear();
+  for(ml_uint ii = 0; ii < checkpoint_trees; ++ii) {
+    ml_string file_name = path + "/" + puml::TREE_MODEL_FILE_PREFIX + std::to_string(ii+1) + ".json";
+    decision_tree tree;
+    if(!std::ifstream(file_name).good() || !tree.restore(file_name, mlid_)) {
+      log_error("couldn't read checkpoint tree: %s\n", file_name.c_str());
+      return(false);
+    }
+    trees_.push_back(tree);
+  }
+
+  oob_errors_.clear();
+  if(base_info.contains<ml_string>("oob_errors")) {
+    for(const auto &json_error : base_info["oob_errors"]) {
+      oob_errors_.push_back(std::make_pair((ml_uint) json_error[0], (ml_double) json_error[1]));
+    }
+  }
+
+  if(forest_feature_importance_.size() != mlid_.size()) {
+    forest_feature_importance_.assign(mlid_.size(), dt_feature_importance{});
+  }
+  feature_importance_ = calculate_feature_importance(mlid_, index_of_feature_to_predict_, forest_feature_importance_);
+
+  reset_out_of_bag((evaluate_oob_ || (early_stopping_window_ > 0)) ? mld.size() : 0);
+  if(!checkpoint_oob_file_.empty() && !oob_counts_.empty() && 
+     !read_checkpoint_out_of_bag(path + "/" + checkpoint_oob_file_, mld)) {
+    return(false);
+  }
+
+  if(complete || (checkpoint_trees >= number_of_trees_)) {
+    return(true);
+  }
+
+  if(mld.empty()) {
+    log_error("rf resume() empty instance data set...\n");
+    return(false);
+  }
+
+  log("resuming training at tree %u of %u\n", checkpoint_trees + 1, number_of_trees_);
+
+  return(add_trees(mld, number_of_trees_ - checkpoint_trees));
+}
+
+
 ml_string random_forest::summary() const {
 
   if(mlid_.empty() || trees_.empty()) {
@@ -511,13 +1601,36 @@ ml_string random_forest::summary() const {
   ml_string type_str = (type_ == ml_model_type::regression) ? "regression" : "classification";
   desc += "Type: " + type_str;
   desc += ", Trees: " + std::to_string(number_of_trees_);
+  if(trees_.size() != number_of_trees_) {
+    desc += " (" + std::to_string(trees_.size()) + " trained)";
+  }
   desc += ", Threads: " + std::to_string(number_of_threads_);
   desc += ", Max Depth: " + std::to_string(max_tree_depth_);
   desc += ", Min Leaf Instances: " + std::to_string(min_leaf_instances_);
   desc += ", Features p/n: " + std::to_string(features_to_consider_per_node_);
   desc += ", Seed: " + std::to_string(seed_);
   desc += ", Eval Out-Of-Bag: " + std::to_string(evaluate_oob_);
+  if(max_samples_ > 0.0) {
+    desc += ", Max Samples: " + std::to_string(max_samples_);
+    desc += ", With Replacement: " + std::to_string(sample_with_replacement_);
+  }
+  if(extra_trees_) {
+    desc += ", Extra Trees: 1";
+  }
+  if(time_budget_ > 0.0) {
+    desc += ", Time Budget: " + std::to_string(time_budget_);
+  }
+  if(memory_budget_ > 0) {
+    desc += ", Memory Budget: " + std::to_string(memory_budget_);
+  }
+  if(early_stopping_window_ > 0) {
+    desc += ", Early Stopping Window: " + std::to_string(early_stopping_window_);
+    desc += ", Tolerance: " + std::to_string(early_stopping_tolerance_);
+  }
   desc += "\n";
+  if(!stop_reason_.empty()) {
+    desc += "Stopped: " + stop_reason_ + "\n";
+  }
   desc += feature_importance_summary(); 
 
   return(desc);
@@ -22,6 +22,8 @@ SOFTWARE.
 
 #pragma once
 
+#include <functional>
+
 #include "decisiontree.h"
 
 namespace puml {
@@ -53,8 +55,73 @@ class random_forest final {
   bool save(const ml_string &path) const;
   bool restore(const ml_string &path);
 		
-  bool train(const ml_data &mld);
+  bool train(const ml_data &mld) { return(train(ml_data_view(mld))); }
+
+  //
+  // train from a view of the data (e.g. a cross-validation fold). out-of-bag
+  // predictions are in the order of the view.
+  //
+  bool train(const ml_data_view &mld);
+
+  //
+  // train from data streamed with a reader (created with this forest's instance 
+  // definition) for data sets larger than memory. Trees are built in batches of 
+  // number_of_threads, each batch needs one pass over the data and only the sampled 
+  // instances are held in memory (use set_max_samples() to bound them). The forest 
+  // matches a single threaded train() on the same data. No out-of-bag evaluation.
+  //
+  bool train(ml_data_reader &reader);
+
+  //
+  // train from sparse data (see decision_tree::train). No out-of-bag evaluation.
+  //
+  bool train(const ml_sparse_data &mlsd);
+
+  //
+  // train from prepared data (see decision_tree::train), all rows or the given rows
+  // (e.g. a cross-validation fold). The data is prepared once for all trees, samples
+  // are drawn as with sparse data. Out-of-bag predictions are in the order of rows. 
+  // No early stopping or checkpointing.
+  //
+  bool train(const ml_prepared_data &mlpd);
+  bool train(const ml_prepared_data &mlpd, const ml_vector<ml_uint> &rows);
+
+  //
+  // warm start: add number_of_trees trees to a trained (or restored) forest. The
+  // trees added here are seeded by their position in the forest (tree i draws its
+  // sample and picks its features with seed + i), so growing a forest in several
+  // steps gives the same trees as one step. Feature importance is merged with that
+  // of the existing trees. Out-of-bag predictions are updated with the new trees 
+  // when mld is the data the forest was trained with (out-of-bag state isn't saved,
+  // so a restored forest's predictions cover the added trees only).
+  //
+  bool train_more(const ml_data &mld, ml_uint number_of_trees) { return(train_more(ml_data_view(mld), number_of_trees)); }
+  bool train_more(const ml_data_view &mld, ml_uint number_of_trees);
+
+  //
+  // continue a checkpointed train() (see set_checkpoint()) that was interrupted: 
+  // restores the forest from the checkpoint in path and adds the missing trees
+  // with the same per tree seeds, so the forest matches an uninterrupted run. mld
+  // must be the training data (its out-of-bag totals are only reused if the size
+  // matches). Checkpointing continues in path. The time budget of the resumed run is
+  // the one set on this forest (set_time_budget() before resume(), none by default),
+  // not the checkpointed run's.
+  //
+  bool resume(const ml_string &path, const ml_data &mld) { return(resume(path, ml_data_view(mld))); }
+  bool resume(const ml_string &path, const ml_data_view &mld);
+
   ml_feature_value evaluate(const ml_instance &instance) const;
+  ml_feature_value evaluate(const ml_sparse_data &mlsd, std::size_t row) const;
+
+  //
+  // Class probabilities (classification): the mean of the trees' leaf class proportions 
+  // (see decision_tree::predict_proba()), by discrete_value_index. These are soft votes,
+  // evaluate() takes the majority of the trees' predictions. The batch version spreads
+  // the instances over number_of_threads threads and returns them in order.
+  //
+  ml_vector<ml_double> predict_proba(const ml_instance &instance) const;
+  ml_vector<ml_vector<ml_double>> predict_proba(const ml_data &mld) const { return(predict_proba(ml_data_view(mld))); }
+  ml_vector<ml_vector<ml_double>> predict_proba(const ml_data_view &mld) const;
 
   ml_string summary() const;
   ml_string feature_importance_summary() const;
@@ -62,13 +129,65 @@ class random_forest final {
   const ml_instance_definition &mlid() const { return(mlid_); }
   const ml_vector<decision_tree> &trees() const { return(trees_); }
   const ml_vector<ml_feature_value> &oob_predictions() const { return(oob_predictions_); }
+  const ml_vector<ml_uint> &oob_counts() const { return(oob_counts_); }
+  ml_double oob_error() const { return(oob_error_); }
+  const ml_string &stop_reason() const { return(stop_reason_); }
   ml_uint index_of_feature_to_predict() const { return(index_of_feature_to_predict_); }
+  ml_uint number_of_threads() const { return(number_of_threads_); }
   ml_model_type type() const { return(type_); }
 
   void set_seed(ml_uint seed) { seed_ = seed;}
   void set_number_of_trees(ml_uint ntrees) { number_of_trees_ = ntrees; }
   void set_number_of_threads(ml_uint nthreads) { number_of_threads_ = nthreads; }
   void set_evaluate_oob(bool eval_oob) { evaluate_oob_ = eval_oob; }
+
+  //
+  // Early stopping: train() (and train_more()) evaluate the out-of-bag error as trees 
+  // complete and stop once it improved by less than tolerance (relative) over the
+  // last window trees, up to number_of_trees. Trees are built in batches of
+  // number_of_threads with per tree seeds (as train_more). A window of 0 (default)
+  // turns it off. stop_reason() (saved with the forest) tells where and why training
+  // stopped. Errors are the error rate for classification and mean squared error
+  // for regression (see oob_error()).
+  //
+  void set_early_stopping(ml_uint window, ml_double tolerance) { early_stopping_window_ = window; early_stopping_tolerance_ = tolerance; }
+
+  //
+  // Training budgets (0, the default, is no budget). With a time budget training stops
+  // taking new trees once the next tree (or batch of trees) would finish after the 
+  // deadline, at the average time of the trees so far. The forest holds the trees that
+  // finished and stop_reason() says so. With a memory budget the sample size of each
+  // tree shrinks if the estimated working set of the trees built at the same time 
+  // (their row samples and the copies made while splitting, plus the sampled instances 
+  // when training from a data reader) would exceed it. The training data isn't counted.
+  //
+  void set_time_budget(ml_double seconds) { time_budget_ = seconds; }
+  void set_memory_budget(uint64_t bytes) { memory_budget_ = bytes; }
+
+  //
+  // Checkpointing: train() and train_more() write the forest to the model directory
+  // path as trees complete (each tree as soon as its batch is built) and commit a 
+  // checkpoint (base info, out-of-bag totals and early stopping history) every 
+  // checkpoint_trees trees and at the end. Trees are built with per tree seeds (as 
+  // train_more). An interrupted run continues with resume(). An empty path (default)
+  // turns it off. Like save(), an existing directory is moved aside first.
+  //
+  void set_checkpoint(const ml_string &path, ml_uint checkpoint_trees = 1) { checkpoint_path_ = path; checkpoint_trees_ = checkpoint_trees; }
+
+  //
+  // Row subsampling for each tree. max_samples <= 0 (default) draws as many rows
+  // as the training data, a value in (0,1] is a fraction of the training rows and 
+  // a value > 1 is a row count (capped at the training size). Rows are drawn with 
+  // replacement (bootstrap) by default.
+  //
+  void set_max_samples(ml_double max_samples) { max_samples_ = max_samples; }
+  void set_sample_with_replacement(bool with_replacement) { sample_with_replacement_ = with_replacement; }
+
+  // see decision_tree::set_categorical_subset_splits()
+  void set_categorical_subset_splits(bool subset_splits) { categorical_subset_splits_ = subset_splits; }
+
+  // see decision_tree::set_extra_trees()
+  void set_extra_trees(bool extra_trees) { extra_trees_ = extra_trees; }
   void set_trees(const ml_vector<decision_tree> &trees);
 
  private:
@@ -83,28 +202,68 @@ class random_forest final {
   ml_uint min_leaf_instances_ = 0;
   ml_uint features_to_consider_per_node_ = 0;
   bool evaluate_oob_ = false;
+  ml_double max_samples_ = 0.0;
+  bool sample_with_replacement_ = true;
+  bool categorical_subset_splits_ = false;
+  bool extra_trees_ = false;
+  ml_uint early_stopping_window_ = 0;
+  ml_double early_stopping_tolerance_ = 0.0;
+  ml_double time_budget_ = 0.0;
+  uint64_t memory_budget_ = 0;
+  ml_string checkpoint_path_;
+  ml_uint checkpoint_trees_ = 1;
 
   // forest structure
   ml_model_type type_;
   ml_vector<decision_tree> trees_;
 
-  // feature importance & out-of-bag error
-  // (available after train(). neither are saved/restored)
+  // feature importance & out-of-bag error (available after train(), the 
+  // feature importance totals are saved/restored, out-of-bag state isn't)
+  ml_vector<dt_feature_importance> forest_feature_importance_;
   ml_vector<feature_importance_tuple> feature_importance_;
   ml_vector<ml_feature_value> oob_predictions_;
+  ml_double oob_error_ = 0.0;
+  ml_string stop_reason_;
+
+  // (number of trees, out-of-bag error) after each batch, for early stopping
+  ml_vector<std::pair<ml_uint, ml_double>> oob_errors_;
+
+  // the last committed checkpoint: number of trees and out-of-bag totals file
+  ml_uint checkpoint_trees_written_ = 0;
+  ml_string checkpoint_oob_file_;
+
+  // out-of-bag totals per training instance: the number of trees that 
+  // didn't sample it and the sum (regression) or class votes of their predictions
+  ml_vector<ml_uint> oob_counts_;
+  ml_vector<ml_double> oob_sums_;
+  ml_vector<ml_uint> oob_votes_;
 
   // implementation
-  bool single_threaded_train(const ml_data &mld, 
+  decision_tree tree_for_training(ml_uint seed) const;
+  ml_uint sample_size_for_memory_budget(ml_uint sample_size, std::size_t bytes_per_row, ml_uint concurrent_trees) const;
+  bool single_threaded_train(const ml_data_view &mld, 
 			     ml_vector<rf_oob_indices> &oobs, 
 			     ml_vector<dt_feature_importance> &forest_feature_importance);
 
-  bool multi_threaded_train(const ml_data &mld, 
+  bool multi_threaded_train(const ml_data_view &mld, 
 			    ml_vector<rf_oob_indices> &oobs, 
 			    ml_vector<dt_feature_importance> &forest_feature_importance);
 
-  bool write_random_forest_base_info_to_file(const ml_string &path) const;
-  bool read_random_forest_base_info_from_file(const ml_string &path);
-  void evaluate_out_of_bag(const ml_data &mld, const ml_vector<rf_oob_indices> &oobs);
+  bool write_random_forest_base_info_to_file(const ml_string &path, const json &checkpoint_info = json::object()) const;
+  bool read_random_forest_base_info_from_file(const ml_string &path, json *base_info = nullptr);
+  bool start_checkpoint();
+  bool write_checkpoint_trees(ml_uint first_tree) const;
+  bool write_checkpoint(bool complete);
+  bool read_checkpoint_out_of_bag(const ml_string &path, const ml_data_view &mld);
+  void reset_out_of_bag(std::size_t size);
+  void add_trees_to_out_of_bag(const ml_data_view &mld, ml_uint first_tree, const ml_vector<rf_oob_indices> &oobs);
+  ml_double out_of_bag_error(const ml_data_view &mld) const;
+  bool out_of_bag_error_converged() const;
+  bool add_trees(const ml_data_view &mld, ml_uint number_of_trees);
+  bool train_batch(ml_uint first_tree, ml_vector<decision_tree> &batch, 
+		   const std::function<bool (decision_tree &tree, ml_uint index)> &train_tree,
+		   ml_vector<dt_feature_importance> &forest_feature_importance);
+  ml_feature_value evaluate_trees(const std::function<ml_feature_value (const decision_tree &tree)> &evaluate_tree) const;
 };
 
 